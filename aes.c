@@ -0,0 +1,265 @@
+/**
+ * Copyright (c) 2018 Wei-Lun Hsu. All Rights Reserved.
+ */
+/** @file aes.c
+ *
+ * @author Wei-Lun Hsu
+ * @version 0.1
+ * @date 2026/10/17
+ * @license
+ * @description
+ */
+
+#include <string.h>
+#include <pthread.h>
+#include "aes.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+    #define AES_HAS_X86
+    #include <immintrin.h>
+#endif
+//=============================================================================
+//                  Constant Definition
+//=============================================================================
+#define AES_CTR_BATCH_NUM       8   // the counter blocks in flight of AES-NI
+//=============================================================================
+//                  Macro Definition
+//=============================================================================
+#define XTIME(x)                ((uint8_t)(((x) << 1) ^ (((x) & 0x80) ? 0x1B : 0x00)))
+//=============================================================================
+//                  Structure Definition
+//=============================================================================
+typedef void (*cb_ctr_crypt_t)(const aes_ctx_t *pCtx, uint8_t *pCounter, uint8_t *pData, size_t len);
+//=============================================================================
+//                  Global Data Definition
+//=============================================================================
+static const uint8_t    g_sbox[256] =
+{
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+};
+
+static cb_ctr_crypt_t   g_ctr_crypt = 0;
+static pthread_once_t   g_ctr_crypt_once = PTHREAD_ONCE_INIT;
+//=============================================================================
+//                  Private Function Definition
+//=============================================================================
+static void
+_aes__counter_inc(uint8_t *pCounter)
+{
+    int     i;
+
+    for(i = AES_BLOCK_SIZE - 1; i >= 0; i--)
+    {
+        if( ++pCounter[i] )
+            break;
+    }
+    return;
+}
+
+static void
+_aes__encrypt_block(
+    const aes_ctx_t *pCtx,
+    const uint8_t   *pIn,
+    uint8_t         *pOut)
+{
+    int         i, round;
+    uint8_t     s[AES_BLOCK_SIZE];
+    uint8_t     t[AES_BLOCK_SIZE];
+
+    for(i = 0; i < AES_BLOCK_SIZE; i++)
+        s[i] = pIn[i] ^ pCtx->round_key[i];
+
+    for(round = 1; round <= AES_ROUND_NUM; round++)
+    {
+        const uint8_t   *pRound_key = &pCtx->round_key[round * AES_BLOCK_SIZE];
+
+        // SubBytes and ShiftRows, the state is column major
+        for(i = 0; i < AES_BLOCK_SIZE; i++)
+            t[i] = g_sbox[s[(i + (i & 0x3) * 4) & 0xF]];
+
+        if( round == AES_ROUND_NUM )
+        {
+            for(i = 0; i < AES_BLOCK_SIZE; i++)
+                s[i] = t[i] ^ pRound_key[i];
+            break;
+        }
+
+        // MixColumns
+        for(i = 0; i < AES_BLOCK_SIZE; i += 4)
+        {
+            uint8_t     a0 = t[i], a1 = t[i + 1], a2 = t[i + 2], a3 = t[i + 3];
+            uint8_t     all = a0 ^ a1 ^ a2 ^ a3;
+
+            s[i]     = a0 ^ all ^ XTIME(a0 ^ a1) ^ pRound_key[i];
+            s[i + 1] = a1 ^ all ^ XTIME(a1 ^ a2) ^ pRound_key[i + 1];
+            s[i + 2] = a2 ^ all ^ XTIME(a2 ^ a3) ^ pRound_key[i + 2];
+            s[i + 3] = a3 ^ all ^ XTIME(a3 ^ a0) ^ pRound_key[i + 3];
+        }
+    }
+
+    memcpy(pOut, s, AES_BLOCK_SIZE);
+    return;
+}
+
+static void
+_aes__ctr_crypt_portable(
+    const aes_ctx_t *pCtx,
+    uint8_t         *pCounter,
+    uint8_t         *pData,
+    size_t          len)
+{
+    uint8_t     key_stream[AES_BLOCK_SIZE];
+
+    while( len )
+    {
+        size_t      i;
+        size_t      n = (len < AES_BLOCK_SIZE) ? len : AES_BLOCK_SIZE;
+
+        _aes__encrypt_block(pCtx, pCounter, key_stream);
+        _aes__counter_inc(pCounter);
+
+        for(i = 0; i < n; i++)
+            pData[i] ^= key_stream[i];
+
+        pData += n;
+        len   -= n;
+    }
+    return;
+}
+
+#if defined(AES_HAS_X86)
+/**
+ *  AES_CTR_BATCH_NUM independent blocks keep the aesenc pipeline busy,
+ *  the tail (less than a batch) takes the portable rounds
+ */
+__attribute__((target("aes,sse2"))) static void
+_aes__ctr_crypt_aesni(
+    const aes_ctx_t *pCtx,
+    uint8_t         *pCounter,
+    uint8_t         *pData,
+    size_t          len)
+{
+    int         i, round;
+    __m128i     round_key[AES_ROUND_NUM + 1];
+    uint8_t     counter[AES_CTR_BATCH_NUM][AES_BLOCK_SIZE];
+
+    for(round = 0; round <= AES_ROUND_NUM; round++)
+        round_key[round] = _mm_loadu_si128((const __m128i*)&pCtx->round_key[round * AES_BLOCK_SIZE]);
+
+    for(; len >= AES_CTR_BATCH_NUM * AES_BLOCK_SIZE; pData += AES_CTR_BATCH_NUM * AES_BLOCK_SIZE, len -= AES_CTR_BATCH_NUM * AES_BLOCK_SIZE)
+    {
+        __m128i     b[AES_CTR_BATCH_NUM];
+
+        for(i = 0; i < AES_CTR_BATCH_NUM; i++)
+        {
+            memcpy(counter[i], pCounter, AES_BLOCK_SIZE);
+            _aes__counter_inc(pCounter);
+            b[i] = _mm_xor_si128(_mm_loadu_si128((const __m128i*)counter[i]), round_key[0]);
+        }
+
+        for(round = 1; round < AES_ROUND_NUM; round++)
+        {
+            for(i = 0; i < AES_CTR_BATCH_NUM; i++)
+                b[i] = _mm_aesenc_si128(b[i], round_key[round]);
+        }
+
+        for(i = 0; i < AES_CTR_BATCH_NUM; i++)
+        {
+            __m128i     *pBlock = (__m128i*)(pData + i * AES_BLOCK_SIZE);
+
+            b[i] = _mm_aesenclast_si128(b[i], round_key[AES_ROUND_NUM]);
+            _mm_storeu_si128(pBlock, _mm_xor_si128(_mm_loadu_si128(pBlock), b[i]));
+        }
+    }
+
+    if( len )
+        _aes__ctr_crypt_portable(pCtx, pCounter, pData, len);
+
+    return;
+}
+#endif
+
+static void
+_aes__select(void)
+{
+    g_ctr_crypt = _aes__ctr_crypt_portable;
+
+#if defined(AES_HAS_X86)
+    __builtin_cpu_init();
+    if( __builtin_cpu_supports("aes") && __builtin_cpu_supports("sse2") )
+        g_ctr_crypt = _aes__ctr_crypt_aesni;
+#endif
+
+    return;
+}
+//=============================================================================
+//                  Public Function Definition
+//=============================================================================
+void
+aes__init(
+    aes_ctx_t       *pCtx,
+    const uint8_t   key[AES_KEY_SIZE])
+{
+    int         i;
+    uint8_t     rcon = 0x01;
+    uint8_t     *pW = pCtx->round_key;
+
+    memcpy(pW, key, AES_KEY_SIZE);
+
+    // the key expansion of AES-128, 4 bytes a word
+    for(i = AES_KEY_SIZE; i < (int)sizeof(pCtx->round_key); i += 4)
+    {
+        uint8_t     t[4];
+
+        memcpy(t, &pW[i - 4], 4);
+
+        if( (i % AES_KEY_SIZE) == 0 )
+        {
+            uint8_t     t0 = t[0];
+
+            t[0] = g_sbox[t[1]] ^ rcon;
+            t[1] = g_sbox[t[2]];
+            t[2] = g_sbox[t[3]];
+            t[3] = g_sbox[t0];
+            rcon = XTIME(rcon);
+        }
+
+        pW[i]     = pW[i - AES_KEY_SIZE] ^ t[0];
+        pW[i + 1] = pW[i - AES_KEY_SIZE + 1] ^ t[1];
+        pW[i + 2] = pW[i - AES_KEY_SIZE + 2] ^ t[2];
+        pW[i + 3] = pW[i - AES_KEY_SIZE + 3] ^ t[3];
+    }
+
+    return;
+}
+
+void
+aes__ctr_crypt(
+    const aes_ctx_t *pCtx,
+    const uint8_t   iv[AES_BLOCK_SIZE],
+    uint8_t         *pData,
+    size_t          len)
+{
+    uint8_t     counter[AES_BLOCK_SIZE];
+
+    pthread_once(&g_ctr_crypt_once, _aes__select);
+
+    memcpy(counter, iv, AES_BLOCK_SIZE);
+    g_ctr_crypt(pCtx, counter, pData, len);
+    return;
+}
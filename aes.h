@@ -0,0 +1,82 @@
+/**
+ * Copyright (c) 2018 Wei-Lun Hsu. All Rights Reserved.
+ */
+/** @file aes.h
+ *
+ * @author Wei-Lun Hsu
+ * @version 0.1
+ * @date 2026/10/17
+ * @license
+ * @description
+ *      AES-128 CTR, AES-NI or the portable rounds (selected at runtime)
+ */
+
+#ifndef __aes_H_q7Xc2LmR_tB4n_HWe8_yKd3_fJ6sV1pZoa9G__
+#define __aes_H_q7Xc2LmR_tB4n_HWe8_yKd3_fJ6sV1pZoa9G__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+//=============================================================================
+//                  Constant Definition
+//=============================================================================
+#define AES_KEY_SIZE            16
+#define AES_BLOCK_SIZE          16
+#define AES_ROUND_NUM           10
+//=============================================================================
+//                  Macro Definition
+//=============================================================================
+
+//=============================================================================
+//                  Structure Definition
+//=============================================================================
+typedef struct aes_ctx
+{
+    uint8_t     round_key[(AES_ROUND_NUM + 1) * AES_BLOCK_SIZE];
+
+} aes_ctx_t;
+//=============================================================================
+//                  Global Data Definition
+//=============================================================================
+
+//=============================================================================
+//                  Private Function Definition
+//=============================================================================
+
+//=============================================================================
+//                  Public Function Definition
+//=============================================================================
+void
+aes__init(
+    aes_ctx_t       *pCtx,
+    const uint8_t   key[AES_KEY_SIZE]);
+
+
+/**
+ *  @brief  aes__ctr_crypt
+ *              encrypt or decrypt in place, the counter is a 128-bit big endian value.
+ *              The context is read only, the threads can share it.
+ *
+ *  @param [in] pCtx            the context of aes__init()
+ *  @param [in] iv              the first counter block
+ *  @param [in] pData           the data
+ *  @param [in] len             the length of the data
+ *  @return
+ *      none
+ */
+void
+aes__ctr_crypt(
+    const aes_ctx_t *pCtx,
+    const uint8_t   iv[AES_BLOCK_SIZE],
+    uint8_t         *pData,
+    size_t          len);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,148 @@
+/**
+ * Copyright (c) 2018 Wei-Lun Hsu. All Rights Reserved.
+ */
+/** @file arena.c
+ *
+ * @author Wei-Lun Hsu
+ * @version 0.1
+ * @date 2026/10/17
+ * @license
+ * @description
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "arena.h"
+//=============================================================================
+//                  Constant Definition
+//=============================================================================
+
+//=============================================================================
+//                  Macro Definition
+//=============================================================================
+#define ARENA_ALIGN(x)          (((x) + (ARENA_ALIGNMENT - 1)) & ~((size_t)ARENA_ALIGNMENT - 1))
+//=============================================================================
+//                  Structure Definition
+//=============================================================================
+typedef struct arena_block
+{
+    struct arena_block  *next;
+
+    size_t      size;   // the size of the data
+    size_t      used;
+
+} arena_block_t;
+
+struct arena
+{
+    pthread_mutex_t     mutex;
+
+    size_t              block_size;
+    arena_block_t       *pCur_block;    // the block to bump
+    arena_block_t       *pBlocks;       // all the blocks
+
+};
+//=============================================================================
+//                  Global Data Definition
+//=============================================================================
+
+//=============================================================================
+//                  Private Function Definition
+//=============================================================================
+static arena_block_t*
+_arena__new_block(
+    arena_t     *pHArena,
+    size_t      size)
+{
+    arena_block_t   *pBlock = 0;
+
+    if( !(pBlock = malloc(ARENA_ALIGN(sizeof(arena_block_t)) + size)) )
+        return 0;
+
+    pBlock->size = size;
+    pBlock->used = 0;
+
+    pBlock->next     = pHArena->pBlocks;
+    pHArena->pBlocks = pBlock;
+    return pBlock;
+}
+//=============================================================================
+//                  Public Function Definition
+//=============================================================================
+arena_t*
+arena__create(
+    size_t      block_size)
+{
+    arena_t     *pHArena = 0;
+
+    if( !(pHArena = malloc(sizeof(arena_t))) )
+        return 0;
+
+    memset(pHArena, 0x0, sizeof(arena_t));
+    pHArena->block_size = (block_size) ? ARENA_ALIGN(block_size) : ARENA_DEFAULT_BLOCK_SIZE;
+
+    pthread_mutex_init(&pHArena->mutex, 0);
+    return pHArena;
+}
+
+void*
+arena__alloc(
+    arena_t     *pHArena,
+    size_t      size)
+{
+    uint8_t         *pMem = 0;
+    arena_block_t   *pBlock = 0;
+
+    size = ARENA_ALIGN((size) ? size : 1);
+
+    pthread_mutex_lock(&pHArena->mutex);
+
+    do {
+        pBlock = pHArena->pCur_block;
+        if( pBlock && pBlock->used + size <= pBlock->size )
+            break;
+
+        if( size > (pHArena->block_size >> 2) )
+        {
+            // a large one has its own block, the current block keeps bumping
+            pBlock = _arena__new_block(pHArena, size);
+            break;
+        }
+
+        if( (pBlock = _arena__new_block(pHArena, pHArena->block_size)) )
+            pHArena->pCur_block = pBlock;
+    } while(0);
+
+    if( pBlock )
+    {
+        pMem = (uint8_t*)pBlock + ARENA_ALIGN(sizeof(arena_block_t)) + pBlock->used;
+        pBlock->used += size;
+    }
+
+    pthread_mutex_unlock(&pHArena->mutex);
+
+    return pMem;
+}
+
+void
+arena__destroy(
+    arena_t     *pHArena)
+{
+    if( !pHArena )
+        return;
+
+    while( pHArena->pBlocks )
+    {
+        arena_block_t   *pCur_block = pHArena->pBlocks;
+
+        pHArena->pBlocks = pCur_block->next;
+        free(pCur_block);
+    }
+
+    pthread_mutex_destroy(&pHArena->mutex);
+    free(pHArena);
+    return;
+}
@@ -0,0 +1,92 @@
+/**
+ * Copyright (c) 2018 Wei-Lun Hsu. All Rights Reserved.
+ */
+/** @file arena.h
+ *
+ * @author Wei-Lun Hsu
+ * @version 0.1
+ * @date 2026/10/17
+ * @license
+ * @description
+ *      a bump allocator in large blocks, the memory of an arena is freed at once by arena__destroy().
+ *      The allocations are thread safe.
+ */
+
+#ifndef __arena_H_wR3kT7Nc_lB5q_HJm2_sVd8_uXa4Ge9Lpz1S__
+#define __arena_H_wR3kT7Nc_lB5q_HJm2_sVd8_uXa4Ge9Lpz1S__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+//=============================================================================
+//                  Constant Definition
+//=============================================================================
+#define ARENA_DEFAULT_BLOCK_SIZE        (256 << 10)
+#define ARENA_ALIGNMENT                 16
+//=============================================================================
+//                  Macro Definition
+//=============================================================================
+
+//=============================================================================
+//                  Structure Definition
+//=============================================================================
+struct arena;
+typedef struct arena    arena_t;
+//=============================================================================
+//                  Global Data Definition
+//=============================================================================
+
+//=============================================================================
+//                  Private Function Definition
+//=============================================================================
+
+//=============================================================================
+//                  Public Function Definition
+//=============================================================================
+/**
+ *  @brief  arena__create
+ *
+ *  @param [in] block_size      the size of a block, 0: ARENA_DEFAULT_BLOCK_SIZE
+ *  @return
+ *      the arena, 0: fail
+ */
+arena_t*
+arena__create(
+    size_t      block_size);
+
+
+/**
+ *  @brief  arena__alloc
+ *              the memory is ARENA_ALIGNMENT aligned and not cleared
+ *
+ *  @param [in] pHArena         the arena
+ *  @param [in] size            the request size
+ *  @return
+ *      the memory, 0: fail
+ */
+void*
+arena__alloc(
+    arena_t     *pHArena,
+    size_t      size);
+
+
+/**
+ *  @brief  arena__destroy
+ *              free all the memory of the arena
+ *
+ *  @param [in] pHArena         the arena (0 is ignored)
+ *  @return
+ *
+ */
+void
+arena__destroy(
+    arena_t     *pHArena);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
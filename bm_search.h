@@ -0,0 +1,118 @@
+/**
+ * Copyright (c) 2018 Wei-Lun Hsu. All Rights Reserved.
+ */
+/** @file bm_search.h
+ *
+ * @author Wei-Lun Hsu
+ * @version 0.1
+ * @date 2026/10/17
+ * @license
+ * @description
+ *      Boyer-Moore-Horspool literal search over raw bytes (no NUL terminator needed)
+ */
+
+#ifndef __bm_search_H_wT4cJ9Lx_l7Qe_HVn3_sBa8_uRm2Zk6Dfs5W__
+#define __bm_search_H_wT4cJ9Lx_l7Qe_HVn3_sBa8_uRm2Zk6Dfs5W__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <string.h>
+//=============================================================================
+//                  Constant Definition
+//=============================================================================
+
+//=============================================================================
+//                  Macro Definition
+//=============================================================================
+
+//=============================================================================
+//                  Structure Definition
+//=============================================================================
+typedef struct bm_search
+{
+    const unsigned char     *pPattern;
+    long                    pattern_len;
+    long                    shift[256];     // bad character shift of the last byte in a window
+
+} bm_search_t;
+//=============================================================================
+//                  Global Data Definition
+//=============================================================================
+
+//=============================================================================
+//                  Private Function Definition
+//=============================================================================
+
+//=============================================================================
+//                  Public Function Definition
+//=============================================================================
+/**
+ *  @brief  bm_search__init
+ *
+ *  @param [in] pHSearch        the searcher
+ *  @param [in] pPattern        the literal (MUST be kept until the searching is done)
+ *  @return
+ *      none
+ */
+static inline void
+bm_search__init(
+    bm_search_t     *pHSearch,
+    const char      *pPattern)
+{
+    long    i;
+
+    pHSearch->pPattern    = (const unsigned char*)pPattern;
+    pHSearch->pattern_len = (long)strlen(pPattern);
+
+    for(i = 0; i < 256; i++)
+        pHSearch->shift[i] = pHSearch->pattern_len;
+
+    for(i = 0; i < pHSearch->pattern_len - 1; i++)
+        pHSearch->shift[pHSearch->pPattern[i]] = pHSearch->pattern_len - 1 - i;
+
+    return;
+}
+
+/**
+ *  @brief  bm_search__find
+ *
+ *  @param [in] pHSearch        the searcher
+ *  @param [in] pBuf            the data
+ *  @param [in] buf_size        the data size
+ *  @return
+ *      the offset of the first match or -1 (not found)
+ */
+static inline long
+bm_search__find(
+    const bm_search_t       *pHSearch,
+    const unsigned char     *pBuf,
+    long                    buf_size)
+{
+    long                    pos = 0;
+    long                    last = pHSearch->pattern_len - 1;
+    const unsigned char     *pPattern = pHSearch->pPattern;
+
+    if( pHSearch->pattern_len <= 0 )
+        return 0;
+
+    while( pos + last < buf_size )
+    {
+        unsigned char   tail = pBuf[pos + last];
+
+        if( tail == pPattern[last] &&
+            !memcmp(pBuf + pos, pPattern, last) )
+            return pos;
+
+        pos += pHSearch->shift[tail];
+    }
+
+    return -1;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,6 +1,36 @@
 
+#include <string.h>
+#include <pthread.h>
 #include "crc32.h"
 
+#if defined(__x86_64__) || defined(__i386__)
+    #define CRC32_HAS_X86
+    #include <immintrin.h>
+#endif
+//=============================================================================
+//                  Constant Definition
+//=============================================================================
+/**
+ *  x^D mod P (P = 0x104C11DB7) to fold a 128-bit block over D bits,
+ *  the high 64 bits take x^(D + 64) mod P
+ */
+#define CRC32_FOLD_128_LO       0xe8a45605
+#define CRC32_FOLD_128_HI       0xc5b9cd4c
+#define CRC32_FOLD_512_LO       0xe6228b11
+#define CRC32_FOLD_512_HI       0x8833794c
+
+#define CRC32_CLMUL_MIN_SIZE    256
+//=============================================================================
+//                  Macro Definition
+//=============================================================================
+
+//=============================================================================
+//                  Structure Definition
+//=============================================================================
+typedef uint32_t (*cb_crc32_update_t)(uint32_t crc, const uint8_t *pData, size_t len);
+//=============================================================================
+//                  Global Data Definition
+//=============================================================================
 static uint32_t const CRC32[256] =
 {
     0x00000000, 0x04c11db7, 0x09823b6e, 0x0d4326d9,
@@ -69,12 +99,154 @@ static uint32_t const CRC32[256] =
     0xbcb4666d, 0xb8757bda, 0xb5365d03, 0xb1f740b4
 };
 
-uint32_t calc_crc32(uint8_t *data, unsigned int dataLength)
+// g_crc32_slice[k][b]: the crc of the byte b followed by k zero bytes
+static uint32_t             g_crc32_slice[8][256];
+static cb_crc32_update_t    g_crc32_update = 0;
+static pthread_once_t       g_crc32_once = PTHREAD_ONCE_INIT;
+//=============================================================================
+//                  Private Function Definition
+//=============================================================================
+static uint32_t
+_crc32_update_slice8(
+    uint32_t        crc,
+    const uint8_t   *pData,
+    size_t          len)
 {
-    uint32_t    crc = 0xFFFFFFFF;
+    // align the pointer for the 8 bytes loop
+    while( len && ((uintptr_t)pData & 0x7) )
+    {
+        crc = (crc << 8) ^ CRC32[(crc >> 24) ^ *pData++];
+        len--;
+    }
+
+    for(; len >= 8; pData += 8, len -= 8)
+    {
+        // MSB-first, the first 4 bytes are the big endian word
+        uint32_t    hi = crc ^ (((uint32_t)pData[0] << 24) | ((uint32_t)pData[1] << 16) |
+                                ((uint32_t)pData[2] << 8) | (uint32_t)pData[3]);
+
+        crc = g_crc32_slice[7][hi >> 24] ^ g_crc32_slice[6][(hi >> 16) & 0xFF] ^
+              g_crc32_slice[5][(hi >> 8) & 0xFF] ^ g_crc32_slice[4][hi & 0xFF] ^
+              g_crc32_slice[3][pData[4]] ^ g_crc32_slice[2][pData[5]] ^
+              g_crc32_slice[1][pData[6]] ^ g_crc32_slice[0][pData[7]];
+    }
 
-    while (dataLength-- > 0)
-        crc = (crc<<8) ^ CRC32[(crc>>24) ^ (uint32_t)(*data++)];
+    while( len-- )
+        crc = (crc << 8) ^ CRC32[(crc >> 24) ^ *pData++];
 
     return crc;
 }
+
+#if defined(CRC32_HAS_X86)
+/**
+ *  fold the message as 128-bit polynomials (the first byte is the highest degree),
+ *  4 lanes over 512 bits and then 1 lane over 128 bits,
+ *  the last 128 bits and the tail bytes are reduced by the tables
+ */
+__attribute__((target("pclmul,ssse3"))) static uint32_t
+_crc32_update_clmul(
+    uint32_t        crc,
+    const uint8_t   *pData,
+    size_t          len)
+{
+    __m128i     x0, x1, x2, x3;
+    __m128i     shuf = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    __m128i     k512 = _mm_set_epi32(0, CRC32_FOLD_512_HI, 0, CRC32_FOLD_512_LO);
+    __m128i     k128 = _mm_set_epi32(0, CRC32_FOLD_128_HI, 0, CRC32_FOLD_128_LO);
+    uint8_t     last[16];
+
+    if( len < CRC32_CLMUL_MIN_SIZE )
+        return _crc32_update_slice8(crc, pData, len);
+
+    #define CRC32_LOAD(p)       _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p)), shuf)
+    #define CRC32_FOLD(x, k)    _mm_xor_si128(_mm_clmulepi64_si128((x), (k), 0x11), _mm_clmulepi64_si128((x), (k), 0x00))
+
+    // the crc is xored to the first 4 bytes
+    x0 = _mm_xor_si128(CRC32_LOAD(pData), _mm_set_epi32((int)crc, 0, 0, 0));
+    x1 = CRC32_LOAD(pData + 16);
+    x2 = CRC32_LOAD(pData + 32);
+    x3 = CRC32_LOAD(pData + 48);
+    pData += 64;
+    len   -= 64;
+
+    for(; len >= 64; pData += 64, len -= 64)
+    {
+        x0 = _mm_xor_si128(CRC32_FOLD(x0, k512), CRC32_LOAD(pData));
+        x1 = _mm_xor_si128(CRC32_FOLD(x1, k512), CRC32_LOAD(pData + 16));
+        x2 = _mm_xor_si128(CRC32_FOLD(x2, k512), CRC32_LOAD(pData + 32));
+        x3 = _mm_xor_si128(CRC32_FOLD(x3, k512), CRC32_LOAD(pData + 48));
+    }
+
+    x0 = _mm_xor_si128(CRC32_FOLD(x0, k128), x1);
+    x0 = _mm_xor_si128(CRC32_FOLD(x0, k128), x2);
+    x0 = _mm_xor_si128(CRC32_FOLD(x0, k128), x3);
+
+    for(; len >= 16; pData += 16, len -= 16)
+        x0 = _mm_xor_si128(CRC32_FOLD(x0, k128), CRC32_LOAD(pData));
+
+    #undef CRC32_LOAD
+    #undef CRC32_FOLD
+
+    // back to the message order, the crc of these bytes (from 0) is the remainder
+    _mm_storeu_si128((__m128i*)last, _mm_shuffle_epi8(x0, shuf));
+
+    crc = _crc32_update_slice8(0, last, sizeof(last));
+    return _crc32_update_slice8(crc, pData, len);
+}
+#endif
+
+static void
+_crc32_setup(void)
+{
+    int     i, k;
+
+    for(i = 0; i < 256; i++)
+    {
+        g_crc32_slice[0][i] = CRC32[i];
+
+        for(k = 1; k < 8; k++)
+            g_crc32_slice[k][i] = (g_crc32_slice[k - 1][i] << 8) ^ CRC32[g_crc32_slice[k - 1][i] >> 24];
+    }
+
+    g_crc32_update = _crc32_update_slice8;
+
+#if defined(CRC32_HAS_X86)
+    __builtin_cpu_init();
+    if( __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3") )
+        g_crc32_update = _crc32_update_clmul;
+#endif
+
+    return;
+}
+//=============================================================================
+//                  Public Function Definition
+//=============================================================================
+uint32_t
+crc32__init(void)
+{
+    return 0xFFFFFFFF;
+}
+
+uint32_t
+crc32__update(
+    uint32_t    crc,
+    const void  *pData,
+    size_t      len)
+{
+    pthread_once(&g_crc32_once, _crc32_setup);
+
+    return (len) ? g_crc32_update(crc, (const uint8_t*)pData, len) : crc;
+}
+
+uint32_t
+crc32__final(
+    uint32_t    crc)
+{
+    // no final xor
+    return crc;
+}
+
+uint32_t calc_crc32(uint8_t *data, unsigned int dataLength)
+{
+    return crc32__final(crc32__update(crc32__init(), data, dataLength));
+}
@@ -1,7 +1,21 @@
-
 #pragma once
 
 #include <stdlib.h>
 #include <stdint.h>
 
+/**
+ *  CRC-32 (poly 0x04C11DB7, MSB-first, init 0xFFFFFFFF, no final xor)
+ *
+ *  crc = crc32__init();
+ *  crc = crc32__update(crc, pData, len);   // any times
+ *  crc = crc32__final(crc);
+ *
+ *  the update takes the PCLMULQDQ path when the cpu has it, or the slicing-by-8 tables
+ */
+uint32_t crc32__init(void);
+
+uint32_t crc32__update(uint32_t crc, const void *pData, size_t len);
+
+uint32_t crc32__final(uint32_t crc);
+
 uint32_t calc_crc32(uint8_t *data, unsigned int dataLength);
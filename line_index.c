@@ -0,0 +1,239 @@
+/**
+ * Copyright (c) 2018 Wei-Lun Hsu. All Rights Reserved.
+ */
+/** @file line_index.c
+ *
+ * @author Wei-Lun Hsu
+ * @version 0.1
+ * @date 2026/10/17
+ * @license
+ * @description
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "line_index.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+    #define LINE_INDEX_HAS_X86
+    #include <immintrin.h>
+#endif
+//=============================================================================
+//                  Constant Definition
+//=============================================================================
+#define LINE_INDEX_MIN_CAPACITY         (4 << 10)
+//=============================================================================
+//                  Macro Definition
+//=============================================================================
+
+//=============================================================================
+//                  Structure Definition
+//=============================================================================
+typedef long (*cb_scan_t)(line_index_t *pIdx, const unsigned char *pBuf, long buf_size);
+//=============================================================================
+//                  Global Data Definition
+//=============================================================================
+static cb_scan_t        g_scan_line = 0;
+static pthread_once_t   g_scan_line_once = PTHREAD_ONCE_INIT;
+//=============================================================================
+//                  Private Function Definition
+//=============================================================================
+static int
+_push_line(
+    line_index_t        *pIdx,
+    const unsigned char *pBuf,
+    long                line_start,
+    long                line_end)
+{
+    line_rec_t      *pRec = 0;
+
+    if( pIdx->line_cnt == pIdx->capacity )
+    {
+        uint32_t    capacity = (pIdx->capacity) ? (pIdx->capacity << 1) : LINE_INDEX_MIN_CAPACITY;
+        line_rec_t  *pLines = realloc(pIdx->pLines, capacity * sizeof(line_rec_t));
+
+        if( !pLines )
+            return -1;
+
+        pIdx->pLines   = pLines;
+        pIdx->capacity = capacity;
+    }
+
+    // CRLF: the '\r' belongs to the terminator
+    if( line_end > line_start && pBuf[line_end - 1] == '\r' )
+        line_end--;
+
+    pRec = &pIdx->pLines[pIdx->line_cnt++];
+    pRec->offset = (uint32_t)line_start;
+    pRec->length = (uint32_t)(line_end - line_start);
+    return 0;
+}
+
+/**
+ *  every scanner returns the start of the first incomplete line (= bytes consumed)
+ *  or -1 when out of memory
+ */
+static long
+_scan_line_scalar(
+    line_index_t        *pIdx,
+    const unsigned char *pBuf,
+    long                buf_size)
+{
+    long    i;
+    long    line_start = 0;
+
+    for(i = 0; i < buf_size; i++)
+    {
+        if( pBuf[i] != '\n' )
+            continue;
+
+        if( _push_line(pIdx, pBuf, line_start, i) )
+            return -1;
+
+        line_start = i + 1;
+    }
+
+    return line_start;
+}
+
+#if defined(LINE_INDEX_HAS_X86)
+__attribute__((target("sse2"))) static long
+_scan_line_sse2(
+    line_index_t        *pIdx,
+    const unsigned char *pBuf,
+    long                buf_size)
+{
+    long        i = 0;
+    long        line_start = 0;
+    __m128i     new_line = _mm_set1_epi8('\n');
+
+    for(i = 0; i + 16 <= buf_size; i += 16)
+    {
+        __m128i     data = _mm_loadu_si128((const __m128i*)(pBuf + i));
+        uint32_t    mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(data, new_line));
+
+        while( mask )
+        {
+            long    pos = i + __builtin_ctz(mask);
+
+            if( _push_line(pIdx, pBuf, line_start, pos) )
+                return -1;
+
+            line_start = pos + 1;
+            mask &= (mask - 1);
+        }
+    }
+
+    for(; i < buf_size; i++)
+    {
+        if( pBuf[i] != '\n' )
+            continue;
+
+        if( _push_line(pIdx, pBuf, line_start, i) )
+            return -1;
+
+        line_start = i + 1;
+    }
+
+    return line_start;
+}
+
+__attribute__((target("avx2"))) static long
+_scan_line_avx2(
+    line_index_t        *pIdx,
+    const unsigned char *pBuf,
+    long                buf_size)
+{
+    long        i = 0;
+    long        line_start = 0;
+    __m256i     new_line = _mm256_set1_epi8('\n');
+
+    for(i = 0; i + 32 <= buf_size; i += 32)
+    {
+        __m256i     data = _mm256_loadu_si256((const __m256i*)(pBuf + i));
+        uint32_t    mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(data, new_line));
+
+        while( mask )
+        {
+            long    pos = i + __builtin_ctz(mask);
+
+            if( _push_line(pIdx, pBuf, line_start, pos) )
+                return -1;
+
+            line_start = pos + 1;
+            mask &= (mask - 1);
+        }
+    }
+
+    for(; i < buf_size; i++)
+    {
+        if( pBuf[i] != '\n' )
+            continue;
+
+        if( _push_line(pIdx, pBuf, line_start, i) )
+            return -1;
+
+        line_start = i + 1;
+    }
+
+    return line_start;
+}
+#endif
+
+static void
+_select_scanner(void)
+{
+    g_scan_line = _scan_line_scalar;
+
+#if defined(LINE_INDEX_HAS_X86)
+    __builtin_cpu_init();
+    if( __builtin_cpu_supports("avx2") )
+        g_scan_line = _scan_line_avx2;
+    else if( __builtin_cpu_supports("sse2") )
+        g_scan_line = _scan_line_sse2;
+#endif
+
+    return;
+}
+//=============================================================================
+//                  Public Function Definition
+//=============================================================================
+int
+line_index__build(
+    line_index_t        *pIdx,
+    const unsigned char *pBuf,
+    long                buf_size,
+    int                 is_last)
+{
+    long    consumed = 0;
+
+    pthread_once(&g_scan_line_once, _select_scanner);
+
+    pIdx->line_cnt = 0;
+    pIdx->consumed = 0;
+
+    if( (consumed = g_scan_line(pIdx, pBuf, buf_size)) < 0 )
+        return -1;
+
+    if( is_last && consumed < buf_size )
+    {
+        if( _push_line(pIdx, pBuf, consumed, buf_size) )
+            return -1;
+
+        consumed = buf_size;
+    }
+
+    pIdx->consumed = consumed;
+    return 0;
+}
+
+void
+line_index__deinit(
+    line_index_t    *pIdx)
+{
+    if( pIdx->pLines )      free(pIdx->pLines);
+
+    memset(pIdx, 0x0, sizeof(line_index_t));
+    return;
+}
@@ -0,0 +1,91 @@
+/**
+ * Copyright (c) 2018 Wei-Lun Hsu. All Rights Reserved.
+ */
+/** @file line_index.h
+ *
+ * @author Wei-Lun Hsu
+ * @version 0.1
+ * @date 2026/10/17
+ * @license
+ * @description
+ *      split a text window into (offset, length) line records with one pass.
+ *      The trailing '\r' of a CRLF line is not a part of the line.
+ */
+
+#ifndef __line_index_H_wq3Nf8Tc_lZ5m_HRa2_sKd7_uPx6Ye4Gbh1J__
+#define __line_index_H_wq3Nf8Tc_lZ5m_HRa2_sKd7_uPx6Ye4Gbh1J__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+//=============================================================================
+//                  Constant Definition
+//=============================================================================
+
+//=============================================================================
+//                  Macro Definition
+//=============================================================================
+
+//=============================================================================
+//                  Structure Definition
+//=============================================================================
+typedef struct line_rec
+{
+    uint32_t    offset;     // start of line, relative to the window
+    uint32_t    length;     // without the line terminator
+
+} line_rec_t;
+
+typedef struct line_index
+{
+    line_rec_t  *pLines;
+    uint32_t    line_cnt;
+    uint32_t    capacity;
+
+    long        consumed;   // bytes of the window covered by pLines (terminators included)
+
+} line_index_t;
+//=============================================================================
+//                  Global Data Definition
+//=============================================================================
+
+//=============================================================================
+//                  Private Function Definition
+//=============================================================================
+
+//=============================================================================
+//                  Public Function Definition
+//=============================================================================
+/**
+ *  @brief  line_index__build
+ *              index the complete lines of pBuf[0 ~ buf_size).
+ *              The records of the previous call are replaced (the storage is reused).
+ *
+ *  @param [in] pIdx            the line index
+ *  @param [in] pBuf            the text window
+ *  @param [in] buf_size        the window size (MUST be < 4 GB)
+ *  @param [in] is_last         the window reaches the end of input,
+ *                              the trailing text without '\n' is also a line
+ *  @return
+ *      0: ok, others: fail
+ */
+int
+line_index__build(
+    line_index_t        *pIdx,
+    const unsigned char *pBuf,
+    long                buf_size,
+    int                 is_last);
+
+
+void
+line_index__deinit(
+    line_index_t    *pIdx);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -9,12 +9,40 @@
  * @license
  * @description
  */
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE     200809L
+#endif
+
+#if !defined(_WIN32) && !defined(_XOPEN_SOURCE)
+#define _XOPEN_SOURCE       700     // realpath()
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <time.h>
+#include <ctype.h>
+
+#if defined(_WIN32)
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
 #include "iniparser.h"
 #include "crc32.h"
 #include "partial_read.h"
+#include "line_index.h"
+#include "bm_search.h"
+#include "task_pool.h"
+#include "parse_cache.h"
+#include "arena.h"
+#include "md5.h"
+#include "aes.h"
 #include "regex.h"
 #include "util.h"
 //=============================================================================
@@ -28,48 +56,285 @@
 #define MAX_BUFFER_SIZE             (2 << 20)
 #define MAX_STR_LEN                 256
 
+#define LINE_WINDOW_SIZE            (1 << 20)
+
+/**
+ *  a mapped memory map section is split into chunks of line boundaries with -j N,
+ *  a chunk smaller than MAP_CHUNK_MIN_SIZE is not worth a thread
+ */
+#define MAP_CHUNK_MIN_SIZE          (4 << 20)
+#define MAP_CHUNKS_PER_THREAD       4
+
+// the common literal of both region patterns
+#define REGION_LINE_KEY             "Region "
+
+#define STDIN_PATH                  "-"
+
+/**
+ *  the region lines are only in the memory map section of a map file
+ */
+#define MAP_SECTION_START_MARK      "Memory Map of the image"
+#define MAP_SECTION_END_MARK        "Image component sizes"
+
+/**
+ *  the patterns of MAP_PARSER_REGEX (--regex-parser)
+ */
+#define REGION_REGEX_LOAD           "\\s+Load Region (\\w+) \\(Base: 0x([0-9a-fA-F]+), Size: 0x([0-9a-fA-F]+), Max: 0x([0-9a-fA-F]+),.*\\)$"
+#define REGION_REGEX_EXEC           "\\s+Execution Region (\\w+) \\(Base: 0x([0-9a-fA-F]+), Size: 0x([0-9a-fA-F]+), Max: 0x([0-9a-fA-F]+),.*\\)$"
+
+/**
+ *  --watch: the events of an input are collected until it is quiet for WATCH_SETTLE_MS,
+ *  a file is complete when it is closed after writing or moved in
+ */
+#define WATCH_SETTLE_MS             200
+#define WATCH_EVENT_MASK            (IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM)
+
 #define DECLARING_MESSAGE           "Automatically generated file; DO NOT EDIT."
+
+#define STRING_BUF_INIT_SIZE        (4 << 10)
+
+/**
+ *  the fw header words:
+ *      host mark (2), uid mark (2), md5 (4), AES enable, AES info offset, total F/W number,
+ *      the offset of each fw info, { configuration, F/W mark, rom number, { offset, destination, size [, crc32] } x rom } x fw
+ */
+#define FW_HEADER_PREFIX_MEMBER_CNT 11
+#define FW_HEADER_FW_MEMBER_CNT     3
+#define FW_HEADER_ROM_MEMBER_CNT    3
+#define FW_HEADER_ROM_CRC_MEMBER_CNT    1
+
+/**
+ *  the configuration bits of a fw info
+ */
+#define FW_CONFIG_ROM_CRC32         0x1     // a rom info has the crc32 of its flash space
+
+/**
+ *  the AES info words at the AES info offset:
+ *      AES mode, rom number, { IV (4) } x rom
+ */
+#define AES_INFO_PREFIX_MEMBER_CNT  2
+#define AES_INFO_ROM_MEMBER_CNT     (AES_BLOCK_SIZE >> 2)
+#define AES_MODE_AES128_CTR         0x1
+
+/**
+ *  the IV of a rom is HMAC-MD5(IV key, LE32 rom address || LE32 rom size || plain rom),
+ *  the IV key is the AES block of this label (the AES key is not the HMAC key)
+ */
+#define AES_IV_KEY_LABEL            "gsl rom iv key\0"
+
+#define END_MARK_SIZE               16
+#define END_MARK_WORD               0xEEEEEEEE
+
+#define IMAGE_IO_BLOCK_SIZE         (1 << 20)
+
+// the per-emitting arrays are a few words per rom
+#define EMIT_ARENA_BLOCK_SIZE       (16 << 10)
+
+/**
+ *  the flash delta (little endian, no padding):
+ *      magic, version, flash start address, sector size,
+ *      base image size, base image crc32, image size, image crc32, changed sector number,
+ *      { offset, size, base crc32, crc32, data (size bytes) } x changed sector
+ *  the base crc32 of a sector takes the bytes of the base image in the sector (0xFFFFFFFF: none)
+ */
+#define FLASH_DELTA_MAGIC           0x4C445746      // "FWDL"
+#define FLASH_DELTA_VERSION         1
+#define FLASH_DELTA_HEADER_MEMBER_CNT   9
+#define FLASH_DELTA_SECTOR_MEMBER_CNT   4
+
+/**
+ *  the flash image in the formats of the programmers
+ */
+#define IHEX_DATA_LEN               16
+#define IHEX_RECORD_MAX_LEN         (1 + (5 + IHEX_DATA_LEN) * 2 + 2)   // ':', { count, address (2), type, data, checksum }, "\n"
+#define SREC_DATA_LEN               16
+#define SREC_RECORD_MAX_LEN         (2 + (6 + SREC_DATA_LEN) * 2 + 2)   // "Sn", { count, address (4), data, checksum }, "\n"
+
+#define ELF32_EHDR_SIZE             52
+#define ELF32_PHDR_SIZE             32
+#define ELF32_SHDR_SIZE             40
+#define ELF32_SHSTRTAB              "\0.fwimage\0.shstrtab\0"
+#define ELF32_SHSTRTAB_SIZE         (sizeof(ELF32_SHSTRTAB))
+#define ELF32_EM_ARM                40
+#define ELF32_EF_ARM_EABI_VER5      0x05000000
 //=============================================================================
 //                  Macro Definition
 //=============================================================================
-#define err_msg(str, args...)           do{ fprintf(stderr, "%s[%u] " str, __func__, __LINE__, ##args); while(1);}while(0)
+#define err_msg(str, args...)           do{ fprintf(stderr, "%s[%u] " str, __func__, __LINE__, ##args); while(g_is_err_hang);}while(0)
 
 #define dbg_msg(str, args...)           fprintf(stderr, "%s[%u] " str, __func__, __LINE__, ##args);
 
+#define PUSH_HEX_BYTE(pCur, value)                                                  \
+    do{ *(pCur)++ = g_hex_digit[((value) >> 4) & 0xF];                              \
+        *(pCur)++ = g_hex_digit[(value) & 0xF];                                     \
+    }while(0)
+
 #define REGEX_MATCH_EXTRACT(pBuf, pLine_str, regmatch_info, match_idx)     \
     strncpy(pBuf, &pLine_str[regmatch_info[match_idx].rm_so], regmatch_info[match_idx].rm_eo - regmatch_info[match_idx].rm_so)
 
+// \s and \w of the regex patterns
+#define IS_SPACE_CHAR(c)    ((c) == ' ' || ((c) >= '\t' && (c) <= '\r'))
+#define IS_WORD_CHAR(c)     (((c) >= 'a' && (c) <= 'z') || ((c) >= 'A' && (c) <= 'Z') || ((c) >= '0' && (c) <= '9') || (c) == '_')
+
 #define BIG_ENDIAN(x)       ((((x) & 0xff) << 24) | (((x) & 0xff00) << 8) | (((x) & 0xff0000) >> 8) | (((x) & 0xff000000) >> 24))
 //=============================================================================
 //                  Structure Definition
 //=============================================================================
-typedef struct rom_info
+typedef enum map_section
+{
+    MAP_SECTION_SEEK    = 0,    // before MAP_SECTION_START_MARK
+    MAP_SECTION_BODY,
+    MAP_SECTION_DONE,           // MAP_SECTION_END_MARK is reached
+
+} map_section_t;
+
+typedef enum map_parser
+{
+    MAP_PARSER_LEXER    = 0,    // the hand-written region line lexer (default)
+    MAP_PARSER_REGEX,           // --regex-parser
+    MAP_PARSER_VERIFY,          // --verify-parser, run both and report the differences
+
+} map_parser_t;
+
+typedef enum region_type
+{
+    REGION_TYPE_LOAD    = 0,
+    REGION_TYPE_EXEC,
+
+    REGION_TYPE_NUM
+} region_type_t;
+
+typedef enum out_file
 {
-    struct rom_info     *next;
+    OUT_FILE_ROM_MERGE_LIST     = 0,
+    OUT_FILE_APP_BLD_HEADER,
+    OUT_FILE_FW_HEADER,
+    OUT_FILE_END_PADDING,
+    OUT_FILE_FLASH_IMAGE,
+
+    OUT_FILE_NUM
+} out_file_t;
+
+#define OUT_FILE_MASK_ALL           ((0x1 << OUT_FILE_NUM) - 1)
 
-    char            rom_name[64];
+typedef struct region_line
+{
+    char            name[64];
     unsigned long   base_addr;
-    unsigned long   rom_max_size;
-    unsigned long   rom_size;
+    unsigned long   size;
+    unsigned long   max_size;
+
+} region_line_t;
+
+typedef struct region_matcher
+{
+    map_parser_t    parser;
+
+    regex_t         hRegex[REGION_TYPE_NUM];
+    int             regex_cnt;
+
+    uint32_t        verify_cnt;
+    uint32_t        mismatch_cnt;
+
+} region_matcher_t;
+
+typedef struct region_event
+{
+    uint32_t        type_mask;  // (0x1 << region_type_t), a line may match both patterns
+    region_line_t   region;     // the fields of the Execution Region
+
+} region_event_t;
+
+/**
+ *  a part of the memory map section, the pairing of Load and Execution Regions
+ *  crosses the chunks, so the matched lines are kept in file order and replayed serially
+ */
+typedef struct map_chunk
+{
+    const unsigned char     *pStart;
+    long                    size;
+    map_parser_t            parser;
+
+    region_event_t          *pEvents;
+    uint32_t                event_cnt;
+    uint32_t                capacity;
+
+} map_chunk_t;
 
-} rom_info_t;
+typedef char    rom_name_t[64];
 
+/**
+ *  the rom records of a map file, struct of arrays in file order.
+ *  The arrays are one allocation of pArena, a larger one replaces them when they are full.
+ */
 typedef struct fw_info
 {
-    struct fw_info  *next;
+    arena_t         *pArena;
 
     uint32_t        fw_uid;
     uint32_t        rom_cnt;
-    rom_info_t      *pRom_info;
+    uint32_t        rom_capacity;
+
+    rom_name_t      *pRom_name;
+    unsigned long   *pBase_addr;
+    unsigned long   *pRom_size;
+    unsigned long   *pRom_max_size;
 
 } fw_info_t;
 
+/**
+ *  the flash placement of the roms of all fw (fw order), shared by the emitters
+ */
+typedef struct layout_plan
+{
+    uint32_t        flash_start_addr;   // the fw header
+    uint32_t        alignment;
+    uint32_t        pack_alignment;     // 0: compat placement
+
+    uint32_t        rom_cnt;
+    uint32_t        *pAddr;             // the flash address of a rom
+    uint32_t        *pAligned_size;     // the flash space of a rom
+    uint32_t        end_addr;           // the end of the image
+    uint32_t        compat_end_addr;    // the end of the image with the compat placement
+
+} layout_plan_t;
+
+typedef struct parse_task
+{
+    partial_read_t  *pHReader;      // one reader per map file
+    fw_info_t       *pFw_info;      // one fw info per map file, ini order
+    const uint8_t   *pIs_selected;  // the map files to parse
+    map_parser_t    parser;
+    int             chunk_thread_num;   // the threads of a large map file
+    int             *pCache_state;      // parse_cache__lookup() of a map file, 0: from the cache, no parsing
+
+} parse_task_t;
+
+/**
+ *  the fw header, the words are shared by the fw header .s and the flash image
+ */
+typedef struct fw_header
+{
+    uint32_t        bEnable_AES;
+    uint8_t         host_mark[8];
+    uint32_t        uid_mark_0;
+    uint32_t        uid_mark_1;
+    uint32_t        md5[4];
+    uint32_t        *pRom_crc;      // the crc32 of the flash space of each rom (plan order), 0: no rom crc
+    uint8_t         *pAes_iv;       // the IV (AES_BLOCK_SIZE bytes) of each rom (plan order), bEnable_AES only
+
+    uint32_t        word_cnt;       // the header words, the AES info words follow
+    uint32_t        aes_word_cnt;
+    uint32_t        *pWords;
+
+} fw_header_t;
+
 typedef struct out_args
 {
+    int     is_force_write;     // rewrite the output even if the content is the same
+
     union {
         struct {
-            uint32_t        flash_start_addr;
-            uint32_t        alignment;
             char            *pBin_dir;
         } rom_merge_list;
 
@@ -80,22 +345,46 @@ typedef struct out_args
         } app_bld_header;
 
         struct {
-            uint32_t        fw_num;
-            uint32_t        bEnable_AES;
-            uint32_t        flash_start_addr;
-            uint8_t         host_mark[8];
-            uint32_t        uid_mark_0;
-            uint32_t        uid_mark_1;
-            uint32_t        md5[4];
-            uint32_t        alignment;
+            fw_header_t     *pHeader;
         } fw_header;
+
+        struct {
+            uint8_t         *pImage;    // the image with the header words
+        } flash_image;
+
+        struct {
+            const char      *pBase_path;    // the previous flash image
+            uint8_t         *pImage;
+            int             thread_num;
+        } flash_delta;
     };
 
 } out_args_t;
+
+typedef struct gen_ctx
+{
+    const char      *pIni_path;
+    dictionary      *pIni;
+    char            *pBin_dir;      // the native target_bin_dir (before the '\' conversion)
+
+    map_parser_t    parser;
+    int             thread_num;
+    int             is_cache_off;
+    int             is_watch;
+
+    int             map_file_cnt;
+    arena_t         *pArena;        // owns the records of the last parsing, pFw_info included
+    fw_info_t       *pFw_info;      // the fw info of each map file, ini order
+    parse_cache_t   hCache;
+
+} gen_ctx_t;
 //=============================================================================
 //                  Global Data Definition
 //=============================================================================
+static const char   g_hex_digit[] = "0123456789ABCDEF";
 
+// err_msg() stops here for the debugger, --watch reports the error and keeps running
+static volatile int g_is_err_hang = 1;
 //=============================================================================
 //                  Private Function Definition
 //=============================================================================
@@ -114,13 +403,34 @@ _create_reader(
             break;
         }
 
-        if( !(pHReader->fp = fopen(pPath, "rb")) )
+        if( !strcmp(pPath, STDIN_PATH) )
+        {
+            #if defined(_WIN32)
+            _setmode(_fileno(stdin), _O_BINARY);
+            #endif
+            pHReader->fp = stdin;
+        }
+        else if( !(pHReader->fp = fopen(pPath, "rb")) )
         {
             err_msg("open '%s' fail \n", pPath);
             rval = -1;
             break;
         }
 
+        // .map.gz / .map.zst are decompressed while reading
+        if( partial_read__open_codec(pHReader) )
+        {
+            err_msg("'%s': compressed data is not supported (codec %d)\n", pPath, pHReader->codec);
+            rval = -1;
+            break;
+        }
+
+        // regular files are walked in place, others fall back to the buffered mode
+        if( pHReader->codec == PARTIAL_READ_CODEC_NONE &&
+            !partial_read__map_file(pHReader) )
+            break;
+
+        pHReader->mode     = PARTIAL_READ_MODE_BUFFER;
         pHReader->buf_size = MAX_BUFFER_SIZE;
         if( !(pHReader->pBuf = malloc(pHReader->buf_size)) )
         {
@@ -132,21 +442,34 @@ _create_reader(
         pHReader->pCur          = pHReader->pBuf;
         pHReader->pEnd          = pHReader->pCur;
 
-        fseek(pHReader->fp, 0l, SEEK_END);
-        pHReader->file_size = ftell(pHReader->fp);
-        fseek(pHReader->fp, 0l, SEEK_SET);
+        // pipe, FIFO or process substitution: no size, read until end of file
+        if( pHReader->is_stream ||
+            fseek(pHReader->fp, 0l, SEEK_END) ||
+            (pHReader->file_size = ftell(pHReader->fp)) < 0 )
+        {
+            pHReader->is_stream = 1;
+            pHReader->file_size = -1;
+        }
+        else
+            fseek(pHReader->fp, 0l, SEEK_SET);
 
         pHReader->file_remain = pHReader->file_size;
 
+        // load the next chunk in the background while the current one is parsed
+        partial_read__start_async(pHReader);
+
     } while(0);
 
     if( rval )
     {
-        if( pHReader->fp )      fclose(pHReader->fp);
+        if( pHReader->fp && pHReader->fp != stdin )
+            fclose(pHReader->fp);
         pHReader->fp = 0;
 
         if( pHReader->pBuf )    free(pHReader->pBuf);
         pHReader->pBuf = 0;
+
+        partial_read__close_codec(pHReader);
     }
 
     return rval;
@@ -158,7 +481,17 @@ _destroy_reader(
 {
     int         rval = 0;
 
-    if( pHReader->fp )      fclose(pHReader->fp);
+    if( pHReader->mode == PARTIAL_READ_MODE_MMAP )
+        partial_read__unmap_file(pHReader);
+
+    if( pHReader->mode == PARTIAL_READ_MODE_ASYNC )
+        partial_read__stop_async(pHReader);
+
+    partial_read__close_codec(pHReader);
+
+    if( pHReader->fp && pHReader->fp != stdin )
+        fclose(pHReader->fp);
+
     if( pHReader->pBuf )    free(pHReader->pBuf);
 
     memset(pHReader, 0x0, sizeof(partial_read_t));
@@ -166,660 +499,3175 @@ _destroy_reader(
 }
 
 static int
-_post_read(unsigned char *pBuf, int buf_size)
-{
-    int     i;
-    for(i = 0; i < buf_size; ++i)
-    {
-        if( pBuf[i] == '\n' || pBuf[i] == '\r' )
-            pBuf[i] = '\0';
-    }
-    return 0;
-}
-
-
-static int
-_parse_map_file(
-    partial_read_t  *pHReader,
-    fw_info_t       *pFw_info)
+_lex_hex(
+    const char      **ppCur,
+    const char      *pEnd,
+    unsigned long   *pValue)
 {
-    int         rval = 0;
-    uint32_t    bFind_load_region = 0;
-    regex_t     hRegex_load_region = {0};
-    regex_t     hRegex_exe_region = {0};
-
-    regcomp(&hRegex_load_region, "\\s+Load Region (\\w+) \\(Base: 0x([0-9a-fA-F]+), Size: 0x([0-9a-fA-F]+), Max: 0x([0-9a-fA-F]+),.*\\)$", REG_EXTENDED);
-    if( rval )
-    {
-        char    msgbuf[MAX_STR_LEN] = {0};
-        regerror(rval, &hRegex_load_region, msgbuf, sizeof(msgbuf));
-        printf("%s\n", msgbuf);
-        return -1;
-    }
+    const char      *pCur = *ppCur;
+    unsigned long   value = 0ul;
 
-    regcomp(&hRegex_exe_region, "\\s+Execution Region (\\w+) \\(Base: 0x([0-9a-fA-F]+), Size: 0x([0-9a-fA-F]+), Max: 0x([0-9a-fA-F]+),.*\\)$", REG_EXTENDED);
-    if( rval )
+    while( pCur < pEnd )
     {
-        char    msgbuf[MAX_STR_LEN] = {0};
-        regerror(rval, &hRegex_load_region, msgbuf, sizeof(msgbuf));
-        printf("%s\n", msgbuf);
-        return -1;
-    }
+        unsigned long   digit = 0ul;
 
-    partial_read__full_buf(pHReader, _post_read);
-    while( pHReader->pCur < pHReader->pEnd )
-    {
-        if( partial_read__full_buf(pHReader, _post_read) )
-        {
+        if( *pCur >= '0' && *pCur <= '9' )          digit = *pCur - '0';
+        else if( *pCur >= 'a' && *pCur <= 'f' )     digit = *pCur - 'a' + 10;
+        else if( *pCur >= 'A' && *pCur <= 'F' )     digit = *pCur - 'A' + 10;
+        else
             break;
-        }
-
-        {   // start parsing a line
-            char            *pAct_str = 0;
-            char            str_buf[MAX_STR_LEN] = {0};
-            size_t          nmatch = 5;
-            regmatch_t      match_info[5] = {{0}};
 
-            pAct_str = (char*)pHReader->pCur;
+        // saturate as strtoul()
+        value = (value > (ULONG_MAX - digit) >> 4) ? ULONG_MAX : (value << 4) + digit;
+        pCur++;
+    }
 
-            pHReader->pCur += (strlen((char*)pHReader->pCur) + 1);
+    if( pCur == *ppCur )
+        return -1;
 
-            rval = (bFind_load_region)
-                 ? regexec(&hRegex_exe_region, pAct_str, nmatch, match_info, 0)
-                 : regexec(&hRegex_load_region, pAct_str, nmatch, match_info, 0);
+    *ppCur  = pCur;
+    *pValue = value;
+    return 0;
+}
 
-            if( rval == REG_NOMATCH || rval )
-                continue;
+static int
+_lex_literal(
+    const char      **ppCur,
+    const char      *pEnd,
+    const char      *pLiteral,
+    long            literal_len)
+{
+    if( pEnd - *ppCur < literal_len || memcmp(*ppCur, pLiteral, literal_len) )
+        return -1;
 
-            if( !bFind_load_region )
-            {
-                bFind_load_region = 1;
-                continue;
-            }
+    *ppCur += literal_len;
+    return 0;
+}
 
-            bFind_load_region = 0;
+/**
+ *  "<name> (Base: 0x<hex>, Size: 0x<hex>, Max: 0x<hex>,<any>)" and the line ends with ')'
+ */
+static int
+_lex_region_fields(
+    const char      *pCur,
+    const char      *pEnd,
+    region_line_t   *pRegion)
+{
+#define LEX_LITERAL(pStr)       _lex_literal(&pCur, pEnd, pStr, sizeof(pStr) - 1)
+    const char      *pName = pCur;
+    long            name_len = 0;
 
-            {   // check match items
-                char            *pTmp = str_buf;
-                // unsigned long   base_addr = 0l;
-                // unsigned long   size = 0l;
-                rom_info_t      *pCur_rom_info = 0;
+    while( pCur < pEnd && IS_WORD_CHAR(*pCur) )
+        pCur++;
 
-                if( !(pCur_rom_info = malloc(sizeof(rom_info_t))) )
-                {
-                    rval = -1;
-                    err_msg("malloc rom info (%d) fail !\n", sizeof(rom_info_t));
-                    break;
-                }
-                memset(pCur_rom_info, 0x0, sizeof(rom_info_t));
+    if( !(name_len = pCur - pName) )
+        return -1;
 
-                pFw_info->rom_cnt++;
+    if( LEX_LITERAL(" (Base: 0x") || _lex_hex(&pCur, pEnd, &pRegion->base_addr) ||
+        LEX_LITERAL(", Size: 0x") || _lex_hex(&pCur, pEnd, &pRegion->size) ||
+        LEX_LITERAL(", Max: 0x")  || _lex_hex(&pCur, pEnd, &pRegion->max_size) ||
+        LEX_LITERAL(",") )
+        return -1;
 
-                // extract info
-                memset(pTmp, 0x0, MAX_STR_LEN);
-                if( match_info[1].rm_so != -1 )
-                {
-                    REGEX_MATCH_EXTRACT(pTmp, pAct_str, match_info, 1);
-                    snprintf(pCur_rom_info->rom_name, 64, "%s", pTmp);
-                }
+    snprintf(pRegion->name, sizeof(pRegion->name), "%.*s", (int)name_len, pName);
+    return 0;
+#undef LEX_LITERAL
+}
 
-                memset(pTmp, 0x0, MAX_STR_LEN);
-                if( match_info[2].rm_so != -1 )
-                {
-                    REGEX_MATCH_EXTRACT(pTmp, pAct_str, match_info, 2);
-                    pCur_rom_info->base_addr = strtoul(pTmp, NULL, 16);
-                }
+/**
+ *  the single-pass equivalent of REGION_REGEX_LOAD/REGION_REGEX_EXEC
+ */
+static int
+_lex_region_line(
+    region_type_t   type,
+    const char      *pLine,
+    long            line_len,
+    region_line_t   *pRegion)
+{
+    const char      *pKey = (type == REGION_TYPE_LOAD) ? "Load Region " : "Execution Region ";
+    long            key_len = (long)strlen(pKey);
+    const char      *pEnd = pLine + line_len;
+    const char      *pCur = pLine + 1;   // at least one space in front of the key
 
-                memset(pTmp, 0x0, MAX_STR_LEN);
-                if( match_info[3].rm_so != -1 )
-                {
-                    REGEX_MATCH_EXTRACT(pTmp, pAct_str, match_info, 3);
-                    pCur_rom_info->rom_size = strtoul(pTmp, NULL, 16);
-                }
+    if( line_len <= key_len || pEnd[-1] != ')' )
+        return -1;
 
-                memset(pTmp, 0x0, MAX_STR_LEN);
-                if( match_info[4].rm_so != -1 )
-                {
-                    REGEX_MATCH_EXTRACT(pTmp, pAct_str, match_info, 4);
-                    pCur_rom_info->rom_max_size = strtoul(pTmp, NULL, 16);
-                }
+    while( pCur < pEnd &&
+           (pCur = memchr(pCur, pKey[0], pEnd - pCur)) )
+    {
+        const char  *pAct = pCur++;
 
-                // add node to rom info
-                if( !pFw_info->pRom_info )
-                    pFw_info->pRom_info = pCur_rom_info;
-                else
-                {
-                    rom_info_t  *pTmp = pFw_info->pRom_info;
-                    while( pTmp->next )
-                        pTmp = pTmp->next;
+        if( !IS_SPACE_CHAR(pAct[-1]) ||
+            _lex_literal(&pAct, pEnd, pKey, key_len) )
+            continue;
 
-                    pTmp->next = pCur_rom_info;
-                }
-            }
-        }
+        if( !_lex_region_fields(pAct, pEnd, pRegion) )
+            return 0;
     }
 
-
-    return rval;
+    return -1;
 }
 
 static int
-_output_rom_merge_list(
-    fw_info_t       *pFw_info,
-    const char      *pOut_path,
-    out_args_t      *pArgs)
+_regex_region_line(
+    regex_t         *pHRegex,
+    const char      *pLine,
+    long            line_len,
+    region_line_t   *pRegion)
 {
-    int         rval = 0;
-    FILE        *fout = 0;
-    uint32_t    prev_addr = 0;
-    uint32_t    prev_size = 0;
+    char            str_buf[MAX_STR_LEN] = {0};
+    char            *pTmp = str_buf;
+    size_t          nmatch = 5;
+    regmatch_t      match_info[5] = {{0}};
+
+    /**
+     *  the buffer may be a read-only file mapping, so lines are not NUL-terminated.
+     *  Let regexec() work on [rm_so, rm_eo) of the line (REG_STARTEND)
+     */
+    match_info[0].rm_so = 0;
+    match_info[0].rm_eo = line_len;
+
+    if( regexec(pHRegex, pLine, nmatch, match_info, REG_STARTEND) )
+        return -1;
 
-    if( !(fout = fopen(pOut_path, "w")) )
+    // extract info
+    memset(pTmp, 0x0, MAX_STR_LEN);
+    if( match_info[1].rm_so != -1 )
     {
-        rval = -1;
-        err_msg("open %s fail \n", pOut_path);
-        return rval;
+        REGEX_MATCH_EXTRACT(pTmp, pLine, match_info, 1);
+        snprintf(pRegion->name, sizeof(pRegion->name), "%s", pTmp);
     }
 
-    fprintf(fout, "; %s\n\n", DECLARING_MESSAGE);
-
-    prev_addr = pArgs->rom_merge_list.flash_start_addr;
-
-    while( pFw_info )
+    memset(pTmp, 0x0, MAX_STR_LEN);
+    if( match_info[2].rm_so != -1 )
     {
-        fw_info_t       *pCur_fw_info = pFw_info;
-        rom_info_t      *pTmp_rom_info = pCur_fw_info->pRom_info;
-
-        pFw_info = pCur_fw_info->next;
-
-        while( pTmp_rom_info )
-        {
-            uint32_t    value = 0;
-            rom_info_t  *pCur_rom_info = pTmp_rom_info;
-
-            pTmp_rom_info = pCur_rom_info->next;
-
-            value = (prev_addr + prev_size + pArgs->rom_merge_list.alignment) / pArgs->rom_merge_list.alignment;
-            value = value * pArgs->rom_merge_list.alignment;
-
-            fprintf(fout, "    AREA    |.ARM.__at_0x%X|, DATA, READONLY\n", value);
-            fprintf(fout, "    INCBIN %s\%s.bin\n\n", pArgs->rom_merge_list.pBin_dir, pCur_rom_info->rom_name);
-
-            prev_addr = value;
-            prev_size = pCur_rom_info->rom_size;
-        }
+        REGEX_MATCH_EXTRACT(pTmp, pLine, match_info, 2);
+        pRegion->base_addr = strtoul(pTmp, NULL, 16);
     }
 
-    fprintf(fout, "%s\n", "AREA END");
+    memset(pTmp, 0x0, MAX_STR_LEN);
+    if( match_info[3].rm_so != -1 )
+    {
+        REGEX_MATCH_EXTRACT(pTmp, pLine, match_info, 3);
+        pRegion->size = strtoul(pTmp, NULL, 16);
+    }
 
-    if( fout )      fclose(fout);
+    memset(pTmp, 0x0, MAX_STR_LEN);
+    if( match_info[4].rm_so != -1 )
+    {
+        REGEX_MATCH_EXTRACT(pTmp, pLine, match_info, 4);
+        pRegion->max_size = strtoul(pTmp, NULL, 16);
+    }
 
-    return rval;
+    return 0;
 }
 
 static int
-_output_app_bld_header(
-    fw_info_t       *pFw_info,
-    const char      *pOut_path,
-    out_args_t      *pArgs)
+_region_matcher__init(
+    region_matcher_t    *pHMatcher,
+    map_parser_t        parser)
 {
     int         rval = 0;
-    FILE        *fout = 0;
-    uint32_t    fw_cnt = 0;
-    uint32_t    max_rom_cnt = 0;
+    int         i;
+    const char  *pPattern[REGION_TYPE_NUM] = { REGION_REGEX_LOAD, REGION_REGEX_EXEC };
 
-    if( !(fout = fopen(pOut_path, "w")) )
-    {
-        rval = -1;
-        err_msg("open %s fail \n", pOut_path);
-        return rval;
-    }
+    memset(pHMatcher, 0x0, sizeof(region_matcher_t));
+    pHMatcher->parser = parser;
 
-    fprintf(fout, "// %s\n\n", DECLARING_MESSAGE);
-    fprintf(fout, "%s", "#ifndef __app_bld_header_h__\n#define __app_bld_header_h__\n\n\n");
+    if( parser == MAP_PARSER_LEXER )
+        return 0;
 
-    while( pFw_info )
+    for(i = 0; i < REGION_TYPE_NUM; i++)
     {
-        fw_info_t       *pCur_fw_info = pFw_info;
-
-        fw_cnt++;
-
-        pFw_info = pCur_fw_info->next;
-
-        max_rom_cnt = (max_rom_cnt > pCur_fw_info->rom_cnt) ? max_rom_cnt : pCur_fw_info->rom_cnt;
+        if( (rval = regcomp(&pHMatcher->hRegex[i], pPattern[i], REG_EXTENDED)) )
+        {
+            char    msgbuf[MAX_STR_LEN] = {0};
+            regerror(rval, &pHMatcher->hRegex[i], msgbuf, sizeof(msgbuf));
+            printf("%s\n", msgbuf);
+            return -1;
+        }
 
-        fprintf(fout, "#define ROM_NUM_IN_PROJ%d        %d\n\n", fw_cnt, pCur_fw_info->rom_cnt);
+        pHMatcher->regex_cnt++;
     }
 
-    fprintf(fout, "#define MAXIMUM_ROM_NUM          %d\n\n", max_rom_cnt);
-    fprintf(fout, "#define PROJECT_NUM              %d\n\n", fw_cnt);
-    fprintf(fout, "#define _IC_RAM_REGION_BASE      0x%08x\n\n", pArgs->app_bld_header.sram_mem_bass_addr);
-    fprintf(fout, "#define _IC_RAM_SIZE             0x%08x\n\n", pArgs->app_bld_header.sram_mem_size);
-    fprintf(fout, "#define _IC_FLASH_REGION_BASE    0x%08x\n\n", pArgs->app_bld_header.flash_mem_bass_addr);
-    fprintf(fout, "\n\n#endif\n\n");
+    return 0;
+}
 
-    if( fout )      fclose(fout);
+static void
+_region_matcher__deinit(
+    region_matcher_t    *pHMatcher)
+{
+    int     i;
 
-    return rval;
+    for(i = 0; i < pHMatcher->regex_cnt; i++)
+        regfree(&pHMatcher->hRegex[i]);
+
+    pHMatcher->regex_cnt = 0;
+    return;
 }
 
+/**
+ *  @brief  _region_matcher__match
+ *
+ *  @param [in] pHMatcher       the matcher
+ *  @param [in] type            Load or Execution Region
+ *  @param [in] pLine           the line (not NUL-terminated)
+ *  @param [in] line_len        the line length
+ *  @param [in] pRegion         the fields of the region
+ *  @return
+ *      0: match, others: no match
+ */
 static int
-_output_fw_header(
-    fw_info_t       *pFw_info,
-    const char      *pOut_path,
-    out_args_t      *pArgs)
+_region_matcher__match(
+    region_matcher_t    *pHMatcher,
+    region_type_t       type,
+    const char          *pLine,
+    long                line_len,
+    region_line_t       *pRegion)
 {
-#define STRING_BUF_SIZE                     (200<<10)
-#define FW_HEADER_PREFIX_MEMBER_CNT         11
-    int         rval = 0;
-    int         i;
-    FILE        *fout = 0;
-    char        *pStr_buf = 0;
-    char        *pStr_fw_info = 0;
-    uint32_t    fw_offset[50] = {0};
-    uint32_t    fw_cnt = 0;
-    uint32_t    prev_addr_offset = pArgs->fw_header.alignment;
-    uint32_t    prev_size = 0;
-    uint32_t    offset_AES_cnt = FW_HEADER_PREFIX_MEMBER_CNT;  // 11 members in prefix (host mark ~ total F/W number)
+    int     i;
 
+    if( pHMatcher->parser == MAP_PARSER_LEXER )
+        return _lex_region_line(type, pLine, line_len, pRegion);
 
-    if( !(fout = fopen(pOut_path, "w")) )
-    {
-        rval = -1;
-        err_msg("open %s fail \n", pOut_path);
-        return rval;
-    }
+    if( pHMatcher->parser == MAP_PARSER_REGEX )
+        return _regex_region_line(&pHMatcher->hRegex[type], pLine, line_len, pRegion);
 
-    if( !(pStr_buf = malloc(STRING_BUF_SIZE)) )
+    // MAP_PARSER_VERIFY: both parsers MUST agree on both region types
+    for(i = 0; i < REGION_TYPE_NUM; i++)
     {
-        rval = -1;
-        err_msg("malloc %d fail \n", STRING_BUF_SIZE);
-        return rval;
+        region_line_t   lex_region = {{0}};
+        region_line_t   regex_region = {{0}};
+        int             lex_rval = _lex_region_line(i, pLine, line_len, &lex_region);
+        int             regex_rval = _regex_region_line(&pHMatcher->hRegex[i], pLine, line_len, &regex_region);
+
+        pHMatcher->verify_cnt++;
+
+        if( (!lex_rval) == (!regex_rval) &&
+            (lex_rval || !memcmp(&lex_region, &regex_region, sizeof(region_line_t))) )
+            continue;
+
+        pHMatcher->mismatch_cnt++;
+        fprintf(stderr, "parser mismatch (lexer %s, regex %s): %.*s\n",
+                (lex_rval) ? "no match" : lex_region.name,
+                (regex_rval) ? "no match" : regex_region.name,
+                (int)line_len, pLine);
     }
-    memset(pStr_buf, 0x0, STRING_BUF_SIZE);
-
 
-    PUSH_STRING(pStr_buf, 0, "; %s\n\n", DECLARING_MESSAGE);
-    PUSH_STRING(pStr_buf, 1, "AREA    |.ARM.__at_0x%08X|, DATA, READONLY\n", pArgs->fw_header.flash_start_addr);
-    PUSH_STRING(pStr_buf, 1, "%s", "MARK\n");
+    return _lex_region_line(type, pLine, line_len, pRegion);
+}
 
+static int
+_fw_info__reserve(
+    fw_info_t   *pFw_info,
+    uint32_t    rom_cnt)
+{
+    uint32_t        capacity = (pFw_info->rom_capacity) ? pFw_info->rom_capacity : 16;
+    uint8_t         *pMem = 0;
+    rom_name_t      *pRom_name = 0;
+    unsigned long   *pBase_addr = 0;
 
-    PUSH_STRING(pStr_buf, 1, "%s", "\n; ==== host mark info (8 characters) ====\n");
-    PUSH_STRING(pStr_buf, 1, "DCD 0x%08x\n    DCD 0x%08x\n",
-                BIG_ENDIAN(*((uint32_t*)pArgs->fw_header.host_mark)),
-                BIG_ENDIAN(*((uint32_t*)pArgs->fw_header.host_mark + 1)));
+    if( rom_cnt <= pFw_info->rom_capacity )
+        return 0;
 
-    PUSH_STRING(pStr_buf, 1, "%s", "\n; ==== uid mark info (16 byte) ====\n");
-    PUSH_STRING(pStr_buf, 1, "DCD 0x%08x\n", pArgs->fw_header.uid_mark_0);
-    PUSH_STRING(pStr_buf, 1, "DCD 0x%08x\n", pArgs->fw_header.uid_mark_1);
+    while( capacity < rom_cnt )
+        capacity <<= 1;
 
-    PUSH_STRING(pStr_buf, 1, "%s", "\n; ==== md5 info (16 bytes) ====\n");
-    PUSH_STRING(pStr_buf, 1, "DCD 0x%08x\n", pArgs->fw_header.md5[0]);
-    PUSH_STRING(pStr_buf, 1, "DCD 0x%08x\n", pArgs->fw_header.md5[1]);
-    PUSH_STRING(pStr_buf, 1, "DCD 0x%08x\n", pArgs->fw_header.md5[2]);
-    PUSH_STRING(pStr_buf, 1, "DCD 0x%08x\n\n", pArgs->fw_header.md5[3]);
+    // the old arrays are left in the arena, the doubling keeps them below the size of the last ones
+    if( !(pMem = arena__alloc(pFw_info->pArena, capacity * (sizeof(rom_name_t) + 3 * sizeof(unsigned long)))) )
+        return -1;
 
-    PUSH_STRING(pStr_buf, 1, "%s", "\n; ==== AES info (16 bytes) ====\n");
-    PUSH_STRING(pStr_buf, 1, "DCD 0x%08x ; Enable AES or not\n", pArgs->fw_header.bEnable_AES);
+    pBase_addr = (unsigned long*)pMem;
+    pRom_name  = (rom_name_t*)(pMem + capacity * 3 * sizeof(unsigned long));
 
-    if( !(pStr_fw_info = malloc(3 << 10)) )
+    if( pFw_info->rom_cnt )
     {
-        rval = -1;
-        err_msg("malloc fail \n");
-        return rval;
+        memcpy(pBase_addr, pFw_info->pBase_addr, pFw_info->rom_cnt * sizeof(unsigned long));
+        memcpy(pBase_addr + capacity, pFw_info->pRom_size, pFw_info->rom_cnt * sizeof(unsigned long));
+        memcpy(pBase_addr + 2 * capacity, pFw_info->pRom_max_size, pFw_info->rom_cnt * sizeof(unsigned long));
+        memcpy(pRom_name, pFw_info->pRom_name, pFw_info->rom_cnt * sizeof(rom_name_t));
     }
-    memset(pStr_fw_info, 0x0, 3 << 10);
 
-    while( pFw_info )
-    {
-        uint32_t        rom_cnt = 0;
-        fw_info_t       *pCur_fw_info = pFw_info;
-        rom_info_t      *pTmp_rom_info = pCur_fw_info->pRom_info;
+    pFw_info->pBase_addr    = pBase_addr;
+    pFw_info->pRom_size     = pBase_addr + capacity;
+    pFw_info->pRom_max_size = pBase_addr + 2 * capacity;
+    pFw_info->pRom_name     = pRom_name;
+    pFw_info->rom_capacity  = capacity;
+    return 0;
+}
 
-        pFw_info = pCur_fw_info->next;
+static int
+_fw_info__add_rom(
+    fw_info_t       *pFw_info,
+    region_line_t   *pRegion)
+{
+    uint32_t    idx = pFw_info->rom_cnt;
 
-        fw_cnt++;
+    if( _fw_info__reserve(pFw_info, idx + 1) )
+    {
+        err_msg("malloc %u rom info fail !\n", idx + 1);
+        return -1;
+    }
 
-        PUSH_STRING(pStr_fw_info, 1, "\n; ==== fw info %d ====\n", fw_cnt);
-        PUSH_STRING(pStr_fw_info, 1, "DCD 0x%08x    ; Configuration\n", 0);                                     fw_offset[fw_cnt]++;
-        PUSH_STRING(pStr_fw_info, 1, "DCD 0x%08x    ; F/W mark\n", pCur_fw_info->fw_uid);                       fw_offset[fw_cnt]++;
-        PUSH_STRING(pStr_fw_info, 1, "DCD 0x%08x    ; Rom Number In Project\n\n", pCur_fw_info->rom_cnt);       fw_offset[fw_cnt]++;
+    snprintf(pFw_info->pRom_name[idx], sizeof(rom_name_t), "%s", pRegion->name);
+    pFw_info->pBase_addr[idx]    = pRegion->base_addr;
+    pFw_info->pRom_size[idx]     = pRegion->size;
+    pFw_info->pRom_max_size[idx] = pRegion->max_size;
 
-        offset_AES_cnt += 3;
+    pFw_info->rom_cnt++;
+    return 0;
+}
 
-        while( pTmp_rom_info )
-        {
-            uint32_t    value = 0;
-            rom_info_t  *pCur_rom_info = pTmp_rom_info;
+/**
+ *  @brief  _fw_info__clone
+ *              copy the records into the arrays of another arena
+ *
+ *  @param [in] pDst            the destination, pDst->pArena is set
+ *  @param [in] pSrc            the source records
+ *  @return
+ *      0: ok, others: fail
+ */
+static int
+_fw_info__clone(
+    fw_info_t   *pDst,
+    fw_info_t   *pSrc)
+{
+    pDst->fw_uid = pSrc->fw_uid;
+    pDst->rom_cnt = 0;
 
-            pTmp_rom_info = pCur_rom_info->next;
+    if( _fw_info__reserve(pDst, pSrc->rom_cnt) )
+        return -1;
 
-            PUSH_STRING(pStr_fw_info, 1, "; ---- rom info %d, %s ----\n", rom_cnt, pCur_rom_info->rom_name);
+    memcpy(pDst->pRom_name, pSrc->pRom_name, pSrc->rom_cnt * sizeof(rom_name_t));
+    memcpy(pDst->pBase_addr, pSrc->pBase_addr, pSrc->rom_cnt * sizeof(unsigned long));
+    memcpy(pDst->pRom_size, pSrc->pRom_size, pSrc->rom_cnt * sizeof(unsigned long));
+    memcpy(pDst->pRom_max_size, pSrc->pRom_max_size, pSrc->rom_cnt * sizeof(unsigned long));
 
-            rom_cnt++;
+    pDst->rom_cnt = pSrc->rom_cnt;
+    return 0;
+}
 
-            value = prev_addr_offset + prev_size;
-            PUSH_STRING(pStr_fw_info, 1, "DCD 0x%08x    ; Address Offset\n", value);    fw_offset[fw_cnt]++;
-            prev_addr_offset = value;
+static int
+_fw_info__from_cache(
+    fw_info_t               *pFw_info,
+    parse_cache_entry_t     *pEntry)
+{
+    uint32_t    i;
 
-            PUSH_STRING(pStr_fw_info, 1, "DCD 0x%08lx    ; Destination Address\n", pCur_rom_info->base_addr);    fw_offset[fw_cnt]++;
+    if( _fw_info__reserve(pFw_info, pFw_info->rom_cnt + pEntry->rom_cnt) )
+        return -1;
 
-            value = (pCur_rom_info->rom_size + pArgs->fw_header.alignment) / pArgs->fw_header.alignment;
-            value *= pArgs->fw_header.alignment;
-            PUSH_STRING(pStr_fw_info, 1, "DCD 0x%08x    ; Rom Size\n\n", value);    fw_offset[fw_cnt]++;
-            prev_size = value;
-        }
+    for(i = 0; i < pEntry->rom_cnt; i++)
+    {
+        region_line_t   region = {{0}};
 
-        offset_AES_cnt += (rom_cnt * 3);
+        snprintf(region.name, sizeof(region.name), "%s", pEntry->pRoms[i].rom_name);
+        region.base_addr = (unsigned long)pEntry->pRoms[i].base_addr;
+        region.size      = (unsigned long)pEntry->pRoms[i].rom_size;
+        region.max_size  = (unsigned long)pEntry->pRoms[i].rom_max_size;
+
+        if( _fw_info__add_rom(pFw_info, &region) )
+            return -1;
     }
 
-    PUSH_STRING(pStr_buf, 1, "DCD 0x%08x ; AES Info Offset\n", (offset_AES_cnt + fw_cnt) << 2);
+    return 0;
+}
 
-    PUSH_STRING(pStr_buf, 1, "%s", "\n; ==== fw info (dynamic size) ====\n");
-    PUSH_STRING(pStr_buf, 1, "DCD 0x%08x ; total F/W Number\n", fw_cnt);
-    for(i = 0; i < fw_cnt; i++)
-    {
-        PUSH_STRING(pStr_buf, 1, "DCD 0x%08x ; Offset of F/W Info %d \n",
-                    (FW_HEADER_PREFIX_MEMBER_CNT + fw_cnt + fw_offset[i]) << 2, i);
-    }
+static int
+_fw_info__to_cache(
+    fw_info_t           *pFw_info,
+    parse_cache_t       *pHCache,
+    const char          *pPath,
+    parse_cache_key_t   *pKey)
+{
+    int                 rval = 0;
+    uint32_t            i;
+    parse_cache_rom_t   *pRoms = 0;
+
+    if( !(pRoms = malloc(pFw_info->rom_cnt * sizeof(parse_cache_rom_t) + 1)) )
+        return -1;
 
-    FLUSH_STRING(fout, pStr_buf);
-    FLUSH_STRING(fout, pStr_fw_info);
+    memset(pRoms, 0x0, pFw_info->rom_cnt * sizeof(parse_cache_rom_t));
 
-    PUSH_STRING(pStr_buf, 1, "%s", "\n; AES data\n");
-    PUSH_STRING(pStr_buf, 1, "%s", "END\n");
-    FLUSH_STRING(fout, pStr_buf);
+    for(i = 0; i < pFw_info->rom_cnt; i++)
+    {
+        snprintf(pRoms[i].rom_name, sizeof(pRoms[i].rom_name), "%s", pFw_info->pRom_name[i]);
+        pRoms[i].base_addr    = pFw_info->pBase_addr[i];
+        pRoms[i].rom_size     = pFw_info->pRom_size[i];
+        pRoms[i].rom_max_size = pFw_info->pRom_max_size[i];
+    }
 
-    if( fout )              fclose(fout);
-    if( pStr_buf )          free(pStr_buf);
-    if( pStr_fw_info )      free(pStr_fw_info);
+    rval = parse_cache__store(pHCache, pPath, pKey, pRoms, pFw_info->rom_cnt);
 
+    free(pRoms);
     return rval;
 }
 
 static int
-_output_end_padding_alignment(
-    fw_info_t       *pFw_info,
-    const char      *pOut_path,
-    out_args_t      *pArgs)
+_map_chunk__push_event(
+    map_chunk_t     *pChunk,
+    region_event_t  *pEvent)
 {
-    int         rval = 0;
-    uint32_t    value = 0;
-    FILE        *fout = 0;
-    uint32_t    prev_addr_offset = pArgs->fw_header.alignment;
-    uint32_t    prev_size = 0;
+    if( pChunk->event_cnt == pChunk->capacity )
+    {
+        uint32_t        capacity = (pChunk->capacity) ? (pChunk->capacity << 1) : 64;
+        region_event_t  *pEvents = realloc(pChunk->pEvents, capacity * sizeof(region_event_t));
+
+        if( !pEvents )
+            return -1;
+
+        pChunk->pEvents  = pEvents;
+        pChunk->capacity = capacity;
+    }
+
+    pChunk->pEvents[pChunk->event_cnt++] = *pEvent;
+    return 0;
+}
 
-    if( !(fout = fopen(pOut_path, "w")) )
+/**
+ *  @brief  _parse_chunk_task
+ *              collect the Load and Execution Region lines of a chunk.
+ *              The pairing state at the chunk start is unknown, so both patterns are matched
+ *              and the pairing is left to _parse_map_chunks().
+ */
+static int
+_parse_chunk_task(void *pTask_info, int task_idx)
+{
+    int                 rval = 0;
+    map_chunk_t         *pChunk = (map_chunk_t*)pTask_info + task_idx;
+    const unsigned char *pCur = pChunk->pStart;
+    const unsigned char *pEnd = pChunk->pStart + pChunk->size;
+    line_index_t        hLine_idx = {0};
+    bm_search_t         hRegion_key = {0};
+    region_matcher_t    hMatcher = {0};
+
+    if( _region_matcher__init(&hMatcher, pChunk->parser) )
     {
-        rval = -1;
-        err_msg("open %s fail \n", pOut_path);
-        return rval;
+        _region_matcher__deinit(&hMatcher);
+        return -1;
     }
 
-    fprintf(fout, "; %s\n\n", DECLARING_MESSAGE);
+    bm_search__init(&hRegion_key, REGION_LINE_KEY);
 
-    while( pFw_info )
+    while( pCur < pEnd )
     {
-        fw_info_t       *pCur_fw_info = pFw_info;
-        rom_info_t      *pTmp_rom_info = pCur_fw_info->pRom_info;
+        int         i;
+        int         is_last = 1;
+        long        win_size = pEnd - pCur;
+
+        if( win_size > LINE_WINDOW_SIZE )
+        {
+            win_size = LINE_WINDOW_SIZE;
+            is_last  = 0;
+        }
+
+        if( line_index__build(&hLine_idx, pCur, win_size, is_last) )
+        {
+            rval = -1;
+            err_msg("index lines fail (%ld bytes)\n", win_size);
+            break;
+        }
 
-        pFw_info = pCur_fw_info->next;
+        // a line longer than the window, take the window as a (truncated) line
+        if( !hLine_idx.line_cnt )
+            line_index__build(&hLine_idx, pCur, win_size, 1);
 
-        while( pTmp_rom_info )
+        for(i = 0; i < hLine_idx.line_cnt; i++)
         {
+            const char      *pAct_str = (char*)pCur + hLine_idx.pLines[i].offset;
+            long            line_len = hLine_idx.pLines[i].length;
+            region_event_t  event = {0};
+            region_line_t   load_region = {{0}};
 
-            rom_info_t  *pCur_rom_info = pTmp_rom_info;
+            // no line matches one of the patterns without the key
+            if( bm_search__find(&hRegion_key, (const unsigned char*)pAct_str, line_len) < 0 )
+                continue;
 
-            pTmp_rom_info = pCur_rom_info->next;
+            if( !_region_matcher__match(&hMatcher, REGION_TYPE_LOAD, pAct_str, line_len, &load_region) )
+                event.type_mask |= (0x1 << REGION_TYPE_LOAD);
 
-            prev_addr_offset = prev_addr_offset + prev_size;
+            if( !_region_matcher__match(&hMatcher, REGION_TYPE_EXEC, pAct_str, line_len, &event.region) )
+                event.type_mask |= (0x1 << REGION_TYPE_EXEC);
 
-            value = (pCur_rom_info->rom_size + pArgs->fw_header.alignment) / pArgs->fw_header.alignment;
-            prev_size = value * pArgs->fw_header.alignment;
-        }
-    }
+            if( !event.type_mask )
+                continue;
 
-    value = prev_addr_offset + prev_size + pArgs->fw_header.flash_start_addr - 16;
+            if( _map_chunk__push_event(pChunk, &event) )
+            {
+                rval = -1;
+                err_msg("malloc region events (%u) fail !\n", pChunk->event_cnt);
+                break;
+            }
+        }
 
-    fprintf(fout,
-        "AREA   |.ARM.__at_0x%08X|, DATA, READONLY\n"
-        "MARK\n"
-        "    DCD 0xEEEEEEEE\n"
-        "    DCD 0xEEEEEEEE\n"
-        "    DCD 0xEEEEEEEE\n"
-        "    DCD 0xEEEEEEEE\n\n"
-        "    END\n\n", value);
+        if( rval < 0 )
+            break;
 
-    if( fout )              fclose(fout);
+        pCur += hLine_idx.consumed;
+    }
 
+    line_index__deinit(&hLine_idx);
+    _region_matcher__deinit(&hMatcher);
     return rval;
 }
-//=============================================================================
-//                  Public Function Definition
-//=============================================================================
-void usage(char *progm)
-{
-    fprintf(stderr, "Copyright (c) 2018~ Wei-Lun Hsu. All rights reserved.\n"
-            "%s [ini file]\n",
-            progm);
-    exit(-1);
-}
 
-int main(int arc, char **argv)
+/**
+ *  @brief  _parse_map_chunks
+ *              parse a mapped memory map section with several threads
+ *
+ *  @param [in] pSection        the start of the memory map section
+ *  @param [in] section_size    the bytes to the end of the file
+ *  @param [in] pHMap_end       the searcher of MAP_SECTION_END_MARK
+ *  @param [in] pFw_info        the fw info to fill
+ *  @param [in] parser          the region line parser (not MAP_PARSER_VERIFY)
+ *  @param [in] thread_num      the number of threads
+ *  @return
+ *      0: ok, others: fail
+ */
+static int
+_parse_map_chunks(
+    const unsigned char *pSection,
+    long                section_size,
+    const bm_search_t   *pHMap_end,
+    fw_info_t           *pFw_info,
+    map_parser_t        parser,
+    int                 thread_num)
 {
     int                 rval = 0;
     int                 i;
-    dictionary          *pIni = 0;
-    int                 map_file_cnt = 0;
-    partial_read_t      *pHReader = 0;
-    fw_info_t           *pFw_info = 0;
-    char                *pIni_path = 0;
+    int                 chunk_cnt = 0;
+    long                pos = 0;
+    uint32_t            bFind_load_region = 0;
+    map_chunk_t         *pChunks = 0;
 
-    do {
-        char        str_buf[MAX_STR_LEN] = {0};
-        const char  *pPath = 0;
+    // stop at the component sizes trailer
+    if( (pos = bm_search__find(pHMap_end, pSection, section_size)) >= 0 )
+        section_size = pos;
+
+    chunk_cnt = (int)(section_size / MAP_CHUNK_MIN_SIZE);
+    chunk_cnt = (chunk_cnt < thread_num * MAP_CHUNKS_PER_THREAD) ? chunk_cnt : thread_num * MAP_CHUNKS_PER_THREAD;
+    chunk_cnt = (chunk_cnt > 0) ? chunk_cnt : 1;
+
+    if( !(pChunks = malloc(chunk_cnt * sizeof(map_chunk_t))) )
+    {
+        err_msg("malloc %d chunks fail !\n", chunk_cnt);
+        return -1;
+    }
+    memset(pChunks, 0x0, chunk_cnt * sizeof(map_chunk_t));
+
+    // every chunk ends behind a '\n', except the last one
+    for(i = 0, pos = 0; i < chunk_cnt; i++)
+    {
+        long    end = section_size;
 
+        if( i < chunk_cnt - 1 )
         {
-            time_t      rawtime;
-            struct tm   *timeinfo;
-            time(&rawtime);
+            const unsigned char     *pNew_line = 0;
 
-            timeinfo = localtime(&rawtime);
+            end = (section_size / chunk_cnt) * (i + 1);
+            end = (end > pos) ? end : pos;
 
-            if( timeinfo->tm_year + 1900 >= LIMIT_YEAR &&
-                timeinfo->tm_mon + 1 >= LIMIT_MONTH )
-                return 0;
+            pNew_line = memchr(pSection + end, '\n', section_size - end);
+            end = (pNew_line) ? (long)(pNew_line - pSection) + 1 : section_size;
         }
 
-        pIni_path = argv[1];
+        pChunks[i].pStart = pSection + pos;
+        pChunks[i].size   = end - pos;
+        pChunks[i].parser = parser;
 
-        pIni = iniparser_load(pIni_path);
-        if( pIni == NULL )
-        {
-            err_msg("cannot parse file: '%s'\n", pIni_path);
-            rval = -1;
-            break;
-        }
+        pos = end;
+    }
 
-        map_file_cnt = iniparser_getint(pIni, "in_file:map_file_cnt", 0);
-        if( !(pHReader = malloc(map_file_cnt * sizeof(partial_read_t))) )
-        {
-            rval = -1;
-            err_msg("malloc %d fail \n", map_file_cnt * sizeof(partial_read_t));
-            break;
-        }
+    rval = task_pool__run(thread_num, chunk_cnt, _parse_chunk_task, pChunks);
 
-        for(i = 0; i < map_file_cnt; i++)
+    // the same pairing as _parse_map_file(), in file order
+    for(i = 0; i < chunk_cnt && !rval; i++)
+    {
+        uint32_t    j;
+
+        for(j = 0; j < pChunks[i].event_cnt; j++)
         {
-            fw_info_t       *pCur_fw_info = 0;
+            region_event_t  *pEvent = &pChunks[i].pEvents[j];
 
-            snprintf(str_buf, MAX_STR_LEN, "in_file:keil_map_file_path_%d", i);
-            pPath = iniparser_getstring(pIni, str_buf, NULL);
-            if( !pPath )
+            if( !bFind_load_region )
             {
-                rval = -1;
-                err_msg("no '%s' file !\n", str_buf);
-                break;
+                bFind_load_region = !!(pEvent->type_mask & (0x1 << REGION_TYPE_LOAD));
+                continue;
             }
 
-            if( (rval = _create_reader(pHReader + i, pPath)) )
-                break;
+            if( !(pEvent->type_mask & (0x1 << REGION_TYPE_EXEC)) )
+                continue;
 
-            if( !(pCur_fw_info = malloc(sizeof(fw_info_t))) )
-            {
-                rval = -1;
-                err_msg("malloc fw info (%d) fail !\n", sizeof(fw_info_t));
+            bFind_load_region = 0;
+
+            if( (rval = _fw_info__add_rom(pFw_info, &pEvent->region)) )
                 break;
-            }
-            memset(pCur_fw_info, 0x0, sizeof(fw_info_t));
+        }
+    }
 
-            snprintf(str_buf, MAX_STR_LEN, "in_file:fw_mark_%d", i);
-            pCur_fw_info->fw_uid = strtoul(iniparser_getstring(pIni, str_buf, NULL), NULL, 16);
+    for(i = 0; i < chunk_cnt; i++)
+    {
+        if( pChunks[i].pEvents )    free(pChunks[i].pEvents);
+    }
 
-            _parse_map_file(pHReader + i, pCur_fw_info);
+    free(pChunks);
+    return rval;
+}
 
-            // add node to fw list
-            if( !pFw_info )
-                pFw_info = pCur_fw_info;
-            else
-            {
-                fw_info_t   *pTmp = pFw_info;
-                while( pTmp->next )
-                    pTmp = pTmp->next;
+static int
+_parse_map_file(
+    partial_read_t  *pHReader,
+    fw_info_t       *pFw_info,
+    map_parser_t    parser,
+    int             thread_num)
+{
+    int                 rval = 0;
+    int                 i;
+    uint32_t            bFind_load_region = 0;
+    line_index_t        hLine_idx = {0};
+    bm_search_t         hMap_start = {0};
+    bm_search_t         hMap_end = {0};
+    map_section_t       section = MAP_SECTION_SEEK;
+    region_matcher_t    hMatcher = {0};
+
+    if( _region_matcher__init(&hMatcher, parser) )
+    {
+        _region_matcher__deinit(&hMatcher);
+        return -1;
+    }
+    if( partial_read__full_buf(pHReader, 0) )
+    {
+        err_msg("read map data fail (broken compressed data ?)\n");
+        _region_matcher__deinit(&hMatcher);
+        return -1;
+    }
 
-                pTmp->next = pCur_fw_info;
-            }
-        }
+    bm_search__init(&hMap_start, MAP_SECTION_START_MARK);
+    bm_search__init(&hMap_end, MAP_SECTION_END_MARK);
 
-        if( rval )  break;
+    while( pHReader->pCur < pHReader->pEnd && section != MAP_SECTION_DONE )
+    {
+        int         is_last = (pHReader->mode == PARTIAL_READ_MODE_MMAP || !pHReader->file_remain);
+        long        win_size = pHReader->pEnd - pHReader->pCur;
+        long        pos = 0;
 
-        #if 0 // debug message
-        while( pFw_info )
+        if( section == MAP_SECTION_SEEK )
         {
-            fw_info_t       *pCur_fw_info = pFw_info;
-
-            pFw_info = pCur_fw_info->next;
-            printf("\n\nrom cnt = %d\n", pCur_fw_info->rom_cnt);
-            while( pCur_fw_info->pRom_info )
+            /**
+             *  the cross references and symbol tables have no region lines,
+             *  skip them without splitting lines.
+             *  A mark crossing the end of the buffered data is kept for the next refill.
+             */
+            if( (pos = bm_search__find(&hMap_start, pHReader->pCur, win_size)) < 0 )
             {
-                rom_info_t  *pCur_rom_info = pCur_fw_info->pRom_info;
+                pos = (is_last || win_size < hMap_start.pattern_len)
+                    ? win_size : win_size - (hMap_start.pattern_len - 1);
+            }
+            else
+                section = MAP_SECTION_BODY;
 
-                pCur_fw_info->pRom_info = pCur_rom_info->next;
+            pHReader->pCur += pos;
 
-                printf("\tname: %s\n", pCur_rom_info->rom_name);
-                printf("\tbase: x%08x\n", pCur_rom_info->base_addr);
-                printf("\tsize: x%08x\n", pCur_rom_info->rom_size);
-                printf("\tmax : x%08x\n\n", pCur_rom_info->rom_max_size);
+            if( partial_read__full_buf(pHReader, 0) )
+            {
+                rval = -1;
+                err_msg("read map data fail (broken compressed data ?)\n");
+                break;
             }
+            continue;
         }
-        #endif
-
-        {   // generate output file
-            char        *pTmp = 0;
-            out_args_t  out_args = {0};
 
+        /**
+         *  the whole section of a mapped file is in memory, split it with -j N.
+         *  MAP_PARSER_VERIFY stays serial to count the checks of the serial pairing
+         */
+        if( pHReader->mode == PARTIAL_READ_MODE_MMAP && thread_num > 1 &&
+            parser != MAP_PARSER_VERIFY && win_size >= (MAP_CHUNK_MIN_SIZE << 1) )
+        {
+            if( (rval = _parse_map_chunks(pHReader->pCur, win_size, &hMap_end, pFw_info, parser, thread_num)) )
+                break;
 
-            //--------------------------------
-            memset(&out_args, 0x0, sizeof(out_args));
-            out_args.rom_merge_list.alignment        = iniparser_getint(pIni, "flash:fw_aligmnet", 0);
-            out_args.rom_merge_list.flash_start_addr = strtoul(iniparser_getstring(pIni, "flash:fw_start_addr", NULL), NULL, 16);
+            pHReader->pCur = pHReader->pEnd;
+            section        = MAP_SECTION_DONE;
+            break;
+        }
 
-            pPath = (char*)iniparser_getstring(pIni, "bin:target_bin_dir", NULL);
-            out_args.rom_merge_list.pBin_dir = (char*)pPath;
+        if( win_size > LINE_WINDOW_SIZE )
+        {
+            win_size = LINE_WINDOW_SIZE;
+            is_last  = 0;
+        }
 
-            while( (pTmp = strstr(pPath, "/")) )
-                *pTmp = '\\';
+        // stop at the component sizes trailer
+        if( (pos = bm_search__find(&hMap_end, pHReader->pCur, win_size)) >= 0 )
+        {
+            win_size = pos;
+            is_last  = 1;
+            section  = MAP_SECTION_DONE;
+        }
 
-            snprintf(str_buf, MAX_STR_LEN, "%s", "out_file:rom_merge_list_path");
-            pPath = iniparser_getstring(pIni, str_buf, NULL);
-            if( !pPath )
-            {
-                rval = -1;
-                err_msg("no '%s' file !\n", str_buf);
-                break;
-            }
-            _output_rom_merge_list(pFw_info, pPath, &out_args);
+        if( line_index__build(&hLine_idx, pHReader->pCur, win_size, is_last) )
+        {
+            rval = -1;
+            err_msg("index lines fail (%ld bytes)\n", win_size);
+            break;
+        }
 
-            //--------------------------------
-            memset(&out_args, 0x0, sizeof(out_args));
-            out_args.app_bld_header.flash_mem_bass_addr = strtoul(iniparser_getstring(pIni, "flash:flash_mem_bass_addr", NULL), NULL, 16);
-            out_args.app_bld_header.sram_mem_bass_addr  = strtoul(iniparser_getstring(pIni, "ram:sram_mem_bass_addr", NULL), NULL, 16);
-            out_args.app_bld_header.sram_mem_size       = strtoul(iniparser_getstring(pIni, "ram:sram_mem_size", NULL), NULL, 16);
-            snprintf(str_buf, MAX_STR_LEN, "%s", "out_file:app_bld_h_path");
-            pPath = iniparser_getstring(pIni, str_buf, NULL);
-            if( !pPath )
-            {
-                rval = -1;
-                err_msg("no '%s' file !\n", str_buf);
-                break;
-            }
-            _output_app_bld_header(pFw_info, pPath, &out_args);
+        // a line longer than the window, take the window as a (truncated) line
+        if( !hLine_idx.line_cnt )
+            line_index__build(&hLine_idx, pHReader->pCur, win_size, 1);
 
-            //--------------------------------
-            memset(&out_args, 0x0, sizeof(out_args));
-            out_args.fw_header.fw_num           = map_file_cnt;
-            out_args.fw_header.alignment        = iniparser_getint(pIni, "flash:fw_aligmnet", 0);
-            out_args.fw_header.flash_start_addr = strtoul(iniparser_getstring(pIni, "flash:fw_start_addr", NULL), NULL, 16);
-            memcpy(out_args.fw_header.host_mark,
-                   iniparser_getstring(pIni, "tag:host_mark", "unknown"),
-                   sizeof(out_args.fw_header.host_mark));
+        for(i = 0; i < hLine_idx.line_cnt; i++)
+        {   // start parsing a line
+            const char      *pAct_str = (char*)pHReader->pCur + hLine_idx.pLines[i].offset;
+            region_line_t   region = {{0}};
 
-            out_args.fw_header.uid_mark_0 = strtoul(iniparser_getstring(pIni, "tag:uid_mark_0", NULL), NULL, 16);
-            out_args.fw_header.uid_mark_1 = strtoul(iniparser_getstring(pIni, "tag:uid_mark_1", NULL), NULL, 16);
+            if( _region_matcher__match(&hMatcher,
+                                       (bFind_load_region) ? REGION_TYPE_EXEC : REGION_TYPE_LOAD,
+                                       pAct_str, hLine_idx.pLines[i].length, &region) )
+                continue;
 
-            snprintf(str_buf, MAX_STR_LEN, "%s", "out_file:fw_header_path");
-            pPath = iniparser_getstring(pIni, str_buf, NULL);
-            if( !pPath )
+            if( !bFind_load_region )
             {
-                rval = -1;
-                err_msg("no '%s' file !\n", str_buf);
-                break;
+                bFind_load_region = 1;
+                continue;
             }
-            _output_fw_header(pFw_info, pPath, &out_args);
 
+            bFind_load_region = 0;
 
-            //--------------------------------
-            memset(&out_args, 0x0, sizeof(out_args));
-            out_args.fw_header.alignment = iniparser_getint(pIni, "flash:fw_aligmnet", 0);
-            out_args.fw_header.flash_start_addr = strtoul(iniparser_getstring(pIni, "flash:fw_start_addr", NULL), NULL, 16);
-            snprintf(str_buf, MAX_STR_LEN, "%s", "out_file:fw_end_padding_s_path");
-            pPath = iniparser_getstring(pIni, str_buf, NULL);
-            if( !pPath )
-            {
-                rval = -1;
-                err_msg("no '%s' file !\n", str_buf);
+            if( (rval = _fw_info__add_rom(pFw_info, &region)) )
                 break;
-            }
-            _output_end_padding_alignment(pFw_info, pPath, &out_args);
         }
-    } while(0);
 
-    if( pHReader )
-    {
-        for(i = 0; i < map_file_cnt; i++)
-            _destroy_reader(pHReader + i);
+        if( rval < 0 )
+            break;
 
-        free(pHReader);
-    }
+        pHReader->pCur += hLine_idx.consumed;
 
-    while( pFw_info )
-    {
-        fw_info_t   *pCur = pFw_info;
+        if( partial_read__full_buf(pHReader, 0) )
+        {
+            rval = -1;
+            err_msg("read map data fail (broken compressed data ?)\n");
+            break;
+        }
+    }
 
-        pFw_info = pCur->next;
+    line_index__deinit(&hLine_idx);
 
-        // free rom info
-        while( pCur->pRom_info )
-        {
-            rom_info_t  *pCur_rom_info = pCur->pRom_info;
+    if( section == MAP_SECTION_SEEK )
+        dbg_msg("no '%s' in the map file, no region is found\n", MAP_SECTION_START_MARK);
 
-            pCur->pRom_info = pCur_rom_info->next;
-            free(pCur_rom_info);
-        }
+    if( parser == MAP_PARSER_VERIFY )
+    {
+        fprintf(stderr, "verify parser: %u checks, %u mismatches\n",
+                hMatcher.verify_cnt, hMatcher.mismatch_cnt);
 
-        free(pCur);
+        if( hMatcher.mismatch_cnt )
+            rval = -1;
     }
 
-    return 0;
-}
+    _region_matcher__deinit(&hMatcher);
 
+    return rval;
+}
+
+static int
+_parse_task(void *pTask_info, int task_idx)
+{
+    parse_task_t    *pTask = (parse_task_t*)pTask_info;
+
+    // not selected or loaded from the parse cache
+    if( !pTask->pIs_selected[task_idx] || !pTask->pCache_state[task_idx] )
+        return 0;
+
+    return _parse_map_file(pTask->pHReader + task_idx, &pTask->pFw_info[task_idx],
+                           pTask->parser, pTask->chunk_thread_num);
+}
+
+/**
+ *  @brief  _is_same_file
+ *              the same path, or the same absolute path after the links and the '..' are resolved
+ *
+ *  @param [in] pPath_a         a file path
+ *  @param [in] pPath_b         a file path
+ *  @return
+ *      1: the same file, 0: others
+ */
+static int
+_is_same_file(
+    const char  *pPath_a,
+    const char  *pPath_b)
+{
+    char    real_a[PATH_MAX] = {0};
+    char    real_b[PATH_MAX] = {0};
+
+    if( !strcmp(pPath_a, pPath_b) )
+        return 1;
+
+#if defined(_WIN32)
+    if( !_fullpath(real_a, pPath_a, PATH_MAX) || !_fullpath(real_b, pPath_b, PATH_MAX) )
+        return 0;
+
+    return !_stricmp(real_a, real_b);
+#else
+    // a file which does not exist yet is not the other one
+    if( !realpath(pPath_a, real_a) || !realpath(pPath_b, real_b) )
+        return 0;
+
+    return !strcmp(real_a, real_b);
+#endif
+}
+
+/**
+ *  @brief  _commit_output
+ *              replace the output file only when the content is different (size, then crc),
+ *              an unchanged output keeps its mtime and does not trigger the rebuilds of its users
+ *
+ *  @param [in] pOut_path       the output file
+ *  @param [in] pData           the new content
+ *  @param [in] size            the size of the new content
+ *  @param [in] is_force        rewrite even if the content is the same
+ *  @param [in] is_binary       a binary file, no new line conversion
+ *  @return
+ *      0: ok, others: fail
+ */
+static int
+_commit_output(
+    const char  *pOut_path,
+    const char  *pData,
+    long        size,
+    int         is_force,
+    int         is_binary)
+{
+    int         rval = 0;
+    FILE        *fout = 0;
+    char        tmp_path[1024 + 8] = {0};
+
+    /**
+     *  the text outputs are CRLF on Windows, the old content is read in the same mode
+     *  and one more byte tells a longer old file
+     */
+    if( !is_force && (fout = fopen(pOut_path, (is_binary) ? "rb" : "r")) )
+    {
+        uint8_t     *pOld = 0;
+        int         is_same = 0;
+
+        if( (pOld = malloc(size + 1)) &&
+            fread(pOld, 1, size + 1, fout) == (size_t)size )
+        {
+            is_same = (calc_crc32(pOld, (unsigned int)size) == calc_crc32((uint8_t*)pData, (unsigned int)size));
+        }
+
+        if( pOld )  free(pOld);
+        fclose(fout);
+        fout = 0;
+
+        if( is_same )
+            return 0;
+    }
+
+    // write aside and rename, the users never see a partial output
+    if( snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", pOut_path) >= (int)sizeof(tmp_path) )
+    {
+        err_msg("'%s' is too long \n", pOut_path);
+        return -1;
+    }
+
+    do {
+        if( !(fout = fopen(tmp_path, (is_binary) ? "wb" : "w")) )
+        {
+            rval = -1;
+            err_msg("open %s fail \n", tmp_path);
+            break;
+        }
+
+        if( fwrite(pData, 1, size, fout) != (size_t)size )
+        {
+            rval = -1;
+            err_msg("write %s fail \n", tmp_path);
+            break;
+        }
+
+        rval = fclose(fout);
+        fout = 0;
+        if( rval )
+        {
+            err_msg("write %s fail \n", tmp_path);
+            break;
+        }
+
+    #if defined(_WIN32)
+        remove(pOut_path);
+    #endif
+        if( (rval = rename(tmp_path, pOut_path)) )
+        {
+            err_msg("rename %s to %s fail \n", tmp_path, pOut_path);
+            break;
+        }
+    } while(0);
+
+    if( fout )      fclose(fout);
+    if( rval )      remove(tmp_path);
+
+    return rval;
+}
+
+static int
+_commit_text(
+    const char      *pOut_path,
+    str_builder_t   *pHStr,
+    int             is_force)
+{
+    if( pHStr->is_fail )
+    {
+        err_msg("out of memory when generating %s \n", pOut_path);
+        return -1;
+    }
+
+    return _commit_output(pOut_path, pHStr->pBuf, (long)pHStr->len, is_force, 0);
+}
+
+/**
+ *  @brief  _push_dcd
+ *              "    DCD 0x%08x" and the tail (comment and new lines), without the printf() parsing
+ *
+ *  @param [in] pHStr           the string builder
+ *  @param [in] value           the word
+ *  @param [in] pTail           the text after the word
+ *  @return
+ *      none
+ */
+static void
+_push_dcd(
+    str_builder_t   *pHStr,
+    unsigned long   value,
+    const char      *pTail)
+{
+    str_builder__append(pHStr, STR_BUILDER_INDENT "DCD 0x", STR_BUILDER_INDENT_LEN + 6);
+    str_builder__hex(pHStr, value, 8);
+    str_builder__append(pHStr, pTail, strlen(pTail));
+    return;
+}
+
+static void
+_put_le16(
+    str_builder_t   *pHStr,
+    uint16_t        value)
+{
+    char    half[2];
+
+    half[0] = (char)(value);
+    half[1] = (char)(value >> 8);
+    str_builder__append(pHStr, half, sizeof(half));
+    return;
+}
+
+static void
+_put_le32(
+    str_builder_t   *pHStr,
+    uint32_t        value)
+{
+    char    word[4];
+
+    word[0] = (char)(value);
+    word[1] = (char)(value >> 8);
+    word[2] = (char)(value >> 16);
+    word[3] = (char)(value >> 24);
+    str_builder__append(pHStr, word, sizeof(word));
+    return;
+}
+
+/**
+ *  @brief  _layout__plan
+ *              place the roms of all fw in flash (fw order), the emitters only read the plan.
+ *              The first rom is one alignment after flash_start_addr (the fw header).
+ *              compat: a rom takes (size + alignment) rounded down to the alignment (a whole
+ *                      extra block when the size is aligned).
+ *              packed: a rom takes its size rounded up to pack_alignment,
+ *                      the end mark has its own END_MARK_SIZE bytes after the last rom.
+ *
+ *  @param [in] pPlan           the plan, the arrays are allocated from pArena
+ *  @param [in] pArena          the arena of one emitting (not the records)
+ *  @param [in] pFw_info        the fw info of each map file
+ *  @param [in] fw_cnt          the number of fw info
+ *  @param [in] flash_start_addr    the flash address of the fw header
+ *  @param [in] alignment       the flash alignment (erase sector) of the image
+ *  @param [in] pack_alignment  the alignment of a packed rom, 0: compat placement
+ *  @return
+ *      0: ok, others: fail
+ */
+static int
+_layout__plan(
+    layout_plan_t   *pPlan,
+    arena_t         *pArena,
+    fw_info_t       *pFw_info,
+    int             fw_cnt,
+    uint32_t        flash_start_addr,
+    uint32_t        alignment,
+    uint32_t        pack_alignment)
+{
+    int         i, j;
+    uint32_t    rom_idx = 0;
+    uint32_t    offset = alignment;
+    uint32_t    compat_offset = alignment;
+
+    memset(pPlan, 0x0, sizeof(layout_plan_t));
+
+    if( !alignment )
+    {
+        err_msg("%s\n", "flash alignment (fw_aligmnet) is 0 !");
+        return -1;
+    }
+
+    for(i = 0; i < fw_cnt; i++)
+        pPlan->rom_cnt += pFw_info[i].rom_cnt;
+
+    if( !(pPlan->pAddr = arena__alloc(pArena, pPlan->rom_cnt * sizeof(uint32_t))) ||
+        !(pPlan->pAligned_size = arena__alloc(pArena, pPlan->rom_cnt * sizeof(uint32_t))) )
+    {
+        err_msg("malloc %u layout items fail \n", pPlan->rom_cnt);
+        return -1;
+    }
+
+    pPlan->flash_start_addr = flash_start_addr;
+    pPlan->alignment        = alignment;
+    pPlan->pack_alignment   = pack_alignment;
+
+    for(i = 0; i < fw_cnt; i++)
+    {
+        fw_info_t       *pCur_fw_info = &pFw_info[i];
+
+        for(j = 0; j < pCur_fw_info->rom_cnt; j++, rom_idx++)
+        {
+            uint32_t    compat_size = (pCur_fw_info->pRom_size[j] + alignment) / alignment * alignment;
+
+            pPlan->pAddr[rom_idx]         = flash_start_addr + offset;
+            pPlan->pAligned_size[rom_idx] = (pack_alignment)
+                                          ? (pCur_fw_info->pRom_size[j] + pack_alignment - 1) / pack_alignment * pack_alignment
+                                          : compat_size;
+
+            offset        += pPlan->pAligned_size[rom_idx];
+            compat_offset += compat_size;
+        }
+    }
+
+    if( pack_alignment )
+        offset = (offset + END_MARK_SIZE + pack_alignment - 1) / pack_alignment * pack_alignment;
+
+    pPlan->end_addr        = flash_start_addr + offset;
+    pPlan->compat_end_addr = flash_start_addr + compat_offset;
+    return 0;
+}
+
+static int
+_output_rom_merge_list(
+    fw_info_t       *pFw_info,
+    int             fw_cnt,
+    layout_plan_t   *pPlan,
+    const char      *pOut_path,
+    out_args_t      *pArgs)
+{
+    int             rval = 0;
+    int             i, j;
+    uint32_t        rom_idx = 0;
+    str_builder_t   hStr;
+
+    str_builder__init(&hStr, STRING_BUF_INIT_SIZE);
+
+    str_builder__printf(&hStr, 0, "; %s\n\n", DECLARING_MESSAGE);
+
+    for(i = 0; i < fw_cnt; i++)
+    {
+        fw_info_t       *pCur_fw_info = &pFw_info[i];
+
+        for(j = 0; j < pCur_fw_info->rom_cnt; j++, rom_idx++)
+        {
+            str_builder__printf(&hStr, 1, "AREA    |.ARM.__at_0x%X|, DATA, READONLY\n", pPlan->pAddr[rom_idx]);
+            str_builder__printf(&hStr, 1, "INCBIN %s\%s.bin\n\n", pArgs->rom_merge_list.pBin_dir, pCur_fw_info->pRom_name[j]);
+        }
+    }
+
+    str_builder__printf(&hStr, 0, "%s\n", "AREA END");
+
+    rval = _commit_text(pOut_path, &hStr, pArgs->is_force_write);
+
+    str_builder__release(&hStr);
+    return rval;
+}
+
+static int
+_output_app_bld_header(
+    fw_info_t       *pFw_info,
+    int             fw_cnt,
+    layout_plan_t   *pPlan,
+    const char      *pOut_path,
+    out_args_t      *pArgs)
+{
+    int             rval = 0;
+    int             i;
+    str_builder_t   hStr;
+    uint32_t        max_rom_cnt = 0;
+
+    str_builder__init(&hStr, STRING_BUF_INIT_SIZE);
+
+    str_builder__printf(&hStr, 0, "// %s\n\n", DECLARING_MESSAGE);
+    str_builder__printf(&hStr, 0, "%s", "#ifndef __app_bld_header_h__\n#define __app_bld_header_h__\n\n\n");
+
+    for(i = 0; i < fw_cnt; i++)
+    {
+        fw_info_t       *pCur_fw_info = &pFw_info[i];
+
+        max_rom_cnt = (max_rom_cnt > pCur_fw_info->rom_cnt) ? max_rom_cnt : pCur_fw_info->rom_cnt;
+
+        str_builder__printf(&hStr, 0, "#define ROM_NUM_IN_PROJ%d        %d\n\n", i + 1, pCur_fw_info->rom_cnt);
+    }
+
+    str_builder__printf(&hStr, 0, "#define MAXIMUM_ROM_NUM          %d\n\n", max_rom_cnt);
+    str_builder__printf(&hStr, 0, "#define PROJECT_NUM              %d\n\n", fw_cnt);
+    str_builder__printf(&hStr, 0, "#define _IC_RAM_REGION_BASE      0x%08x\n\n", pArgs->app_bld_header.sram_mem_bass_addr);
+    str_builder__printf(&hStr, 0, "#define _IC_RAM_SIZE             0x%08x\n\n", pArgs->app_bld_header.sram_mem_size);
+    str_builder__printf(&hStr, 0, "#define _IC_FLASH_REGION_BASE    0x%08x\n\n", pArgs->app_bld_header.flash_mem_bass_addr);
+    str_builder__printf(&hStr, 0, "%s", "\n\n#endif\n\n");
+
+    rval = _commit_text(pOut_path, &hStr, pArgs->is_force_write);
+
+    str_builder__release(&hStr);
+    return rval;
+}
+
+/**
+ *  @brief  _fw_header__build
+ *              fill the words of the fw header from the plan
+ *
+ *  @param [in] pHeader         the header, the marks are set by the caller
+ *  @param [in] pFw_info        the fw info of each map file
+ *  @param [in] fw_cnt          the number of fw info
+ *  @param [in] pPlan           the flash layout
+ *  @return
+ *      0: ok, others: fail
+ */
+static int
+_fw_header__build(
+    fw_header_t     *pHeader,
+    fw_info_t       *pFw_info,
+    int             fw_cnt,
+    layout_plan_t   *pPlan)
+{
+    int         i, j;
+    uint32_t    k = 0;
+    uint32_t    rom_idx = 0;
+    uint32_t    word_offset = 0;
+    uint32_t    *pWords = 0;
+    uint32_t    rom_member_cnt = FW_HEADER_ROM_MEMBER_CNT + ((pHeader->pRom_crc) ? FW_HEADER_ROM_CRC_MEMBER_CNT : 0);
+
+    pHeader->word_cnt = FW_HEADER_PREFIX_MEMBER_CNT + fw_cnt + fw_cnt * FW_HEADER_FW_MEMBER_CNT
+                      + pPlan->rom_cnt * rom_member_cnt;
+
+    pHeader->aes_word_cnt = (pHeader->bEnable_AES)
+                          ? AES_INFO_PREFIX_MEMBER_CNT + pPlan->rom_cnt * AES_INFO_ROM_MEMBER_CNT : 0;
+
+    if( !(pWords = malloc((pHeader->word_cnt + pHeader->aes_word_cnt) * sizeof(uint32_t))) )
+    {
+        err_msg("malloc %u words fail \n", pHeader->word_cnt + pHeader->aes_word_cnt);
+        return -1;
+    }
+    pHeader->pWords = pWords;
+
+    pWords[k++] = BIG_ENDIAN(*((uint32_t*)pHeader->host_mark));
+    pWords[k++] = BIG_ENDIAN(*((uint32_t*)pHeader->host_mark + 1));
+    pWords[k++] = pHeader->uid_mark_0;
+    pWords[k++] = pHeader->uid_mark_1;
+    pWords[k++] = pHeader->md5[0];
+    pWords[k++] = pHeader->md5[1];
+    pWords[k++] = pHeader->md5[2];
+    pWords[k++] = pHeader->md5[3];
+    pWords[k++] = pHeader->bEnable_AES;
+    pWords[k++] = pHeader->word_cnt << 2;  // AES info follows the header
+    pWords[k++] = fw_cnt;
+
+    word_offset = FW_HEADER_PREFIX_MEMBER_CNT + fw_cnt;
+    for(i = 0; i < fw_cnt; i++)
+    {
+        pWords[k++] = word_offset << 2;
+        word_offset += FW_HEADER_FW_MEMBER_CNT + pFw_info[i].rom_cnt * rom_member_cnt;
+    }
+
+    for(i = 0; i < fw_cnt; i++)
+    {
+        fw_info_t       *pCur_fw_info = &pFw_info[i];
+
+        pWords[k++] = (pHeader->pRom_crc) ? FW_CONFIG_ROM_CRC32 : 0;
+        pWords[k++] = pCur_fw_info->fw_uid;
+        pWords[k++] = pCur_fw_info->rom_cnt;
+
+        for(j = 0; j < pCur_fw_info->rom_cnt; j++, rom_idx++)
+        {
+            pWords[k++] = pPlan->pAddr[rom_idx] - pPlan->flash_start_addr;
+            pWords[k++] = (uint32_t)pCur_fw_info->pBase_addr[j];
+            pWords[k++] = pPlan->pAligned_size[rom_idx];
+
+            if( pHeader->pRom_crc )
+                pWords[k++] = pHeader->pRom_crc[rom_idx];
+        }
+    }
+
+    if( !pHeader->bEnable_AES )
+        return 0;
+
+    pWords[k++] = AES_MODE_AES128_CTR;
+    pWords[k++] = pPlan->rom_cnt;
+
+    // the DCD words are little endian, the IV bytes stay in order in flash
+    for(rom_idx = 0; rom_idx < pPlan->rom_cnt; rom_idx++)
+    {
+        for(j = 0; j < AES_INFO_ROM_MEMBER_CNT; j++)
+        {
+            uint8_t     *pIv = &pHeader->pAes_iv[rom_idx * AES_BLOCK_SIZE + (j << 2)];
+
+            pWords[k++] = (uint32_t)pIv[0] | ((uint32_t)pIv[1] << 8) | ((uint32_t)pIv[2] << 16) | ((uint32_t)pIv[3] << 24);
+        }
+    }
+
+    return 0;
+}
+
+static int
+_output_fw_header(
+    fw_info_t       *pFw_info,
+    int             fw_cnt,
+    layout_plan_t   *pPlan,
+    const char      *pOut_path,
+    out_args_t      *pArgs)
+{
+    int             rval = 0;
+    int             i, j;
+    uint32_t        *pWords = pArgs->fw_header.pHeader->pWords;
+    str_builder_t   hStr;
+
+
+    str_builder__init(&hStr, STRING_BUF_INIT_SIZE);
+
+
+    str_builder__printf(&hStr, 0, "; %s\n\n", DECLARING_MESSAGE);
+    str_builder__printf(&hStr, 1, "AREA    |.ARM.__at_0x%08X|, DATA, READONLY\n", pPlan->flash_start_addr);
+    str_builder__printf(&hStr, 1, "%s", "MARK\n");
+
+
+    str_builder__printf(&hStr, 1, "%s", "\n; ==== host mark info (8 characters) ====\n");
+    _push_dcd(&hStr, *pWords++, "\n");
+    _push_dcd(&hStr, *pWords++, "\n");
+
+    str_builder__printf(&hStr, 1, "%s", "\n; ==== uid mark info (16 byte) ====\n");
+    _push_dcd(&hStr, *pWords++, "\n");
+    _push_dcd(&hStr, *pWords++, "\n");
+
+    str_builder__printf(&hStr, 1, "%s", "\n; ==== md5 info (16 bytes) ====\n");
+    _push_dcd(&hStr, *pWords++, "\n");
+    _push_dcd(&hStr, *pWords++, "\n");
+    _push_dcd(&hStr, *pWords++, "\n");
+    _push_dcd(&hStr, *pWords++, "\n\n");
+
+    str_builder__printf(&hStr, 1, "%s", "\n; ==== AES info (16 bytes) ====\n");
+    _push_dcd(&hStr, *pWords++, " ; Enable AES or not\n");
+    _push_dcd(&hStr, *pWords++, " ; AES Info Offset\n");
+
+    str_builder__printf(&hStr, 1, "%s", "\n; ==== fw info (dynamic size) ====\n");
+    _push_dcd(&hStr, *pWords++, " ; total F/W Number\n");
+
+    for(i = 0; i < fw_cnt; i++)
+        str_builder__printf(&hStr, 1, "DCD 0x%08x ; Offset of F/W Info %d \n", *pWords++, i);
+
+    for(i = 0; i < fw_cnt; i++)
+    {
+        fw_info_t       *pCur_fw_info = &pFw_info[i];
+
+        str_builder__printf(&hStr, 1, "\n; ==== fw info %d ====\n", i + 1);
+        _push_dcd(&hStr, *pWords++, "    ; Configuration\n");
+        _push_dcd(&hStr, *pWords++, "    ; F/W mark\n");
+        _push_dcd(&hStr, *pWords++, "    ; Rom Number In Project\n\n");
+
+        for(j = 0; j < pCur_fw_info->rom_cnt; j++)
+        {
+            str_builder__printf(&hStr, 1, "; ---- rom info %d, %s ----\n", j, pCur_fw_info->pRom_name[j]);
+
+            _push_dcd(&hStr, *pWords++, "    ; Address Offset\n");
+            _push_dcd(&hStr, *pWords++, "    ; Destination Address\n");
+
+            if( !pArgs->fw_header.pHeader->pRom_crc )
+            {
+                _push_dcd(&hStr, *pWords++, "    ; Rom Size\n\n");
+                continue;
+            }
+
+            _push_dcd(&hStr, *pWords++, "    ; Rom Size\n");
+            _push_dcd(&hStr, *pWords++, "    ; Rom CRC32\n\n");
+        }
+    }
+
+    str_builder__printf(&hStr, 1, "%s", "\n; AES data\n");
+
+    if( pArgs->fw_header.pHeader->aes_word_cnt )
+    {
+        _push_dcd(&hStr, *pWords++, "    ; AES Mode (1: AES-128-CTR)\n");
+        _push_dcd(&hStr, *pWords++, "    ; Rom Number\n\n");
+
+        for(i = 0; i < fw_cnt; i++)
+        {
+            for(j = 0; j < pFw_info[i].rom_cnt; j++)
+            {
+                str_builder__printf(&hStr, 1, "; ---- fw %d, rom %d, %s IV ----\n", i + 1, j, pFw_info[i].pRom_name[j]);
+                _push_dcd(&hStr, *pWords++, "\n");
+                _push_dcd(&hStr, *pWords++, "\n");
+                _push_dcd(&hStr, *pWords++, "\n");
+                _push_dcd(&hStr, *pWords++, "\n\n");
+            }
+        }
+    }
+
+    str_builder__printf(&hStr, 1, "%s", "END\n");
+
+    rval = _commit_text(pOut_path, &hStr, pArgs->is_force_write);
+
+    str_builder__release(&hStr);
+
+    return rval;
+}
+
+/**
+ *  @brief  _output_fw_header_bin
+ *              the words of the flash image header (with the AES info) in a little endian blob,
+ *              the same bytes as the head of the flash image
+ */
+static int
+_output_fw_header_bin(
+    fw_info_t       *pFw_info,
+    int             fw_cnt,
+    layout_plan_t   *pPlan,
+    const char      *pOut_path,
+    out_args_t      *pArgs)
+{
+    int             rval = 0;
+    uint32_t        k;
+    fw_header_t     *pHeader = pArgs->fw_header.pHeader;
+    uint32_t        word_cnt = pHeader->word_cnt + pHeader->aes_word_cnt;
+    str_builder_t   hStr;
+
+    str_builder__init(&hStr, STRING_BUF_INIT_SIZE);
+    str_builder__reserve(&hStr, word_cnt << 2);
+
+    for(k = 0; k < word_cnt; k++)
+        _put_le32(&hStr, pHeader->pWords[k]);
+
+    if( hStr.is_fail )
+    {
+        rval = -1;
+        err_msg("malloc fw header (%u words) fail \n", word_cnt);
+    }
+    else
+        rval = _commit_output(pOut_path, hStr.pBuf, (long)hStr.len, pArgs->is_force_write, 1);
+
+    str_builder__release(&hStr);
+    return rval;
+}
+
+static int
+_output_end_padding_alignment(
+    fw_info_t       *pFw_info,
+    int             fw_cnt,
+    layout_plan_t   *pPlan,
+    const char      *pOut_path,
+    out_args_t      *pArgs)
+{
+    int             rval = 0;
+    str_builder_t   hStr;
+
+    str_builder__init(&hStr, 512);
+    str_builder__printf(&hStr, 0, "; %s\n\n", DECLARING_MESSAGE);
+
+    // the end mark is the last END_MARK_SIZE bytes of the image
+    str_builder__printf(&hStr, 0,
+        "AREA   |.ARM.__at_0x%08X|, DATA, READONLY\n"
+        "MARK\n"
+        "    DCD 0xEEEEEEEE\n"
+        "    DCD 0xEEEEEEEE\n"
+        "    DCD 0xEEEEEEEE\n"
+        "    DCD 0xEEEEEEEE\n\n"
+        "    END\n\n", pPlan->end_addr - END_MARK_SIZE);
+
+    rval = _commit_text(pOut_path, &hStr, pArgs->is_force_write);
+
+    str_builder__release(&hStr);
+    return rval;
+}
+
+/**
+ *  @brief  _load_bin
+ *              read a bin file to pDst in large blocks
+ *
+ *  @param [in] pPath           the bin file
+ *  @param [in] pDst            the destination
+ *  @param [in] max_size        the space of the destination
+ *  @param [in] pSize           the size of the bin file
+ *  @return
+ *      0: ok, others: fail
+ */
+static int
+_load_bin(
+    const char  *pPath,
+    uint8_t     *pDst,
+    uint32_t    max_size,
+    uint32_t    *pSize)
+{
+    int         rval = 0;
+    FILE        *fin = 0;
+    uint32_t    size = 0;
+
+    do {
+        if( !(fin = fopen(pPath, "rb")) )
+        {
+            rval = -1;
+            err_msg("open %s fail \n", pPath);
+            break;
+        }
+
+        while( 1 )
+        {
+            size_t      len = (max_size - size < IMAGE_IO_BLOCK_SIZE) ? max_size - size : IMAGE_IO_BLOCK_SIZE;
+
+            // one more byte tells a bin file larger than its space
+            len = fread(pDst + size, 1, (len) ? len : 1, fin);
+            if( !len )
+                break;
+
+            if( size + len > max_size )
+            {
+                rval = -1;
+                err_msg("%s is larger than its flash space (0x%x) \n", pPath, max_size);
+                break;
+            }
+            size += len;
+        }
+
+        if( ferror(fin) )
+        {
+            rval = -1;
+            err_msg("read %s fail \n", pPath);
+            break;
+        }
+    } while(0);
+
+    if( fin )   fclose(fin);
+
+    *pSize = size;
+    return rval;
+}
+
+/**
+ *  @brief  _load_aes_key
+ *              the key file is 16 bytes (raw) or 32 hex digits (the white spaces are skipped)
+ *
+ *  @param [in] pPath           the key file
+ *  @param [in] key             the AES-128 key
+ *  @return
+ *      0: ok, others: fail
+ */
+static int
+_load_aes_key(
+    const char  *pPath,
+    uint8_t     key[AES_KEY_SIZE])
+{
+    int         rval = 0;
+    FILE        *fin = 0;
+    uint8_t     buf[128] = {0};
+    size_t      len = 0;
+
+    do {
+        size_t      i;
+        int         digit_cnt = 0;
+
+        if( !(fin = fopen(pPath, "rb")) )
+        {
+            rval = -1;
+            err_msg("open AES key file %s fail \n", pPath);
+            break;
+        }
+
+        len = fread(buf, 1, sizeof(buf), fin);
+        if( len == AES_KEY_SIZE )
+        {
+            memcpy(key, buf, AES_KEY_SIZE);
+            break;
+        }
+
+        for(i = 0; i < len; i++)
+        {
+            int     value = 0;
+
+            if( isspace(buf[i]) )
+                continue;
+
+            if( !isxdigit(buf[i]) || digit_cnt == (AES_KEY_SIZE << 1) )
+            {
+                rval = -1;
+                break;
+            }
+
+            value = (buf[i] <= '9') ? buf[i] - '0' : (tolower(buf[i]) - 'a' + 10);
+            key[digit_cnt >> 1] = (digit_cnt & 0x1) ? (key[digit_cnt >> 1] | value) : (uint8_t)(value << 4);
+            digit_cnt++;
+        }
+
+        if( rval || digit_cnt != (AES_KEY_SIZE << 1) || len == sizeof(buf) )
+        {
+            rval = -1;
+            err_msg("%s is not an AES-128 key (16 bytes or 32 hex digits) \n", pPath);
+            break;
+        }
+    } while(0);
+
+    if( fin )   fclose(fin);
+
+    memset(buf, 0x0, sizeof(buf));
+    return rval;
+}
+
+typedef struct image_load_task
+{
+    uint8_t         *pImage;
+    uint32_t        image_size;
+    layout_plan_t   *pPlan;
+    const char      *pBin_dir;      // native path
+    const char      **ppRom_name;   // the rom name of a plan item
+    uint32_t        *pRom_crc;      // the crc32 of the flash space of a plan item, 0: no crc
+    const aes_ctx_t *pAes;          // encrypt the roms, 0: plain
+    const uint8_t   *pIv_key;       // the HMAC key of the IV
+    uint8_t         *pAes_iv;       // the IV of a plan item
+
+} image_load_task_t;
+
+static int
+_image_load_task(void *pTask_info, int task_idx)
+{
+    int                 rval = 0;
+    image_load_task_t   *pTask = (image_load_task_t*)pTask_info;
+    uint32_t            offset = pTask->pPlan->pAddr[task_idx] - pTask->pPlan->flash_start_addr;
+    uint32_t            bin_size = 0;
+    uint32_t            size = pTask->pPlan->pAligned_size[task_idx];
+    char                path[1024] = {0};
+
+    do {
+        // the same path as the INCBIN of the rom merge list
+        if( snprintf(path, sizeof(path), "%s%s.bin", pTask->pBin_dir, pTask->ppRom_name[task_idx]) >= (int)sizeof(path) )
+        {
+            rval = -1;
+            err_msg("'%s' is too long \n", pTask->ppRom_name[task_idx]);
+            break;
+        }
+
+        // the roms have their own flash space, no lock for the image
+        if( (rval = _load_bin(path, pTask->pImage + offset, pTask->pPlan->pAligned_size[task_idx], &bin_size)) )
+            break;
+
+        if( offset + bin_size > pTask->image_size - END_MARK_SIZE )
+        {
+            rval = -1;
+            err_msg("%s overlaps the end mark \n", path);
+            break;
+        }
+
+        // the space of the last rom (compat) has the end mark, it is not a part of the rom
+        size = (offset + size > pTask->image_size - END_MARK_SIZE) ? pTask->image_size - END_MARK_SIZE - offset : size;
+
+        if( pTask->pAes )
+        {
+            uint8_t         *pIv = &pTask->pAes_iv[task_idx * AES_BLOCK_SIZE];
+            uint32_t        addr = pTask->pPlan->pAddr[task_idx];
+            uint8_t         prefix[8];
+            md5_hmac_ctx_t  hmac_ctx;
+
+            prefix[0] = (uint8_t)addr;
+            prefix[1] = (uint8_t)(addr >> 8);
+            prefix[2] = (uint8_t)(addr >> 16);
+            prefix[3] = (uint8_t)(addr >> 24);
+            prefix[4] = (uint8_t)size;
+            prefix[5] = (uint8_t)(size >> 8);
+            prefix[6] = (uint8_t)(size >> 16);
+            prefix[7] = (uint8_t)(size >> 24);
+
+            // a PRF of the rom and its place: a build is reproducible, the same bin at other addresses
+            // gives other ciphertext, and an IV is not known without the key
+            md5__hmac_init(&hmac_ctx, pTask->pIv_key, AES_KEY_SIZE);
+            md5__hmac_update(&hmac_ctx, prefix, sizeof(prefix));
+            md5__hmac_update(&hmac_ctx, pTask->pImage + offset, size);
+            md5__hmac_final(&hmac_ctx, pIv);
+
+            aes__ctr_crypt(pTask->pAes, pIv, pTask->pImage + offset, size);
+        }
+
+        // the flash space as the bootloader reads it, the bin file and the pad
+        if( pTask->pRom_crc )
+            pTask->pRom_crc[task_idx] = crc32__final(crc32__update(crc32__init(), pTask->pImage + offset, size));
+    } while(0);
+
+    return rval;
+}
+
+/**
+ *  @brief  _flash_image__load
+ *              fill the image with the pad byte, the end mark and the bin files (one task per rom),
+ *              a task encrypts its rom and then takes the crc32 (the bootloader checks the flash content).
+ *              The fw header space is left to _output_flash_image()
+ *
+ *  @param [in] pFw_info        the fw info of each map file
+ *  @param [in] fw_cnt          the number of fw info
+ *  @param [in] pPlan           the flash layout
+ *  @param [in] pBin_dir        the directory of the bin files (native path)
+ *  @param [in] pad_byte        the value of the unused space
+ *  @param [in] thread_num      the threads to read the bin files
+ *  @param [in] pHeader         the rom crc and the AES IV of each rom are filled if they are enabled
+ *  @param [in] pAes            the AES context to encrypt the roms (bEnable_AES only)
+ *  @param [in] pIv_key         the HMAC key of the IV (AES_KEY_SIZE bytes)
+ *  @param [in] ppImage         the image (pPlan->end_addr - pPlan->flash_start_addr bytes), free() by the caller
+ *  @return
+ *      0: ok, others: fail
+ */
+static int
+_flash_image__load(
+    fw_info_t       *pFw_info,
+    int             fw_cnt,
+    layout_plan_t   *pPlan,
+    const char      *pBin_dir,
+    uint8_t         pad_byte,
+    int             thread_num,
+    fw_header_t     *pHeader,
+    const aes_ctx_t *pAes,
+    const uint8_t   *pIv_key,
+    uint8_t         **ppImage)
+{
+    int                 rval = 0;
+    int                 i, j;
+    uint32_t            k;
+    uint32_t            rom_idx = 0;
+    uint32_t            image_size = pPlan->end_addr - pPlan->flash_start_addr;
+    uint8_t             *pImage = 0;
+    image_load_task_t   load_task = {0};
+
+    do {
+        if( !(pImage = malloc(image_size)) ||
+            !(load_task.ppRom_name = malloc((pPlan->rom_cnt + 1) * sizeof(char*))) )
+        {
+            rval = -1;
+            err_msg("malloc image (0x%x) fail \n", image_size);
+            break;
+        }
+        memset(pImage, pad_byte, image_size);
+
+        for(i = 0; i < fw_cnt; i++)
+        {
+            for(j = 0; j < pFw_info[i].rom_cnt; j++, rom_idx++)
+                load_task.ppRom_name[rom_idx] = pFw_info[i].pRom_name[j];
+        }
+
+        // before the bin files, the compat space of the last rom has the end mark
+        for(k = image_size - END_MARK_SIZE; k < image_size; k += 4)
+        {
+            pImage[k]     = (uint8_t)(END_MARK_WORD);
+            pImage[k + 1] = (uint8_t)(END_MARK_WORD >> 8);
+            pImage[k + 2] = (uint8_t)(END_MARK_WORD >> 16);
+            pImage[k + 3] = (uint8_t)(END_MARK_WORD >> 24);
+        }
+
+        load_task.pImage     = pImage;
+        load_task.image_size = image_size;
+        load_task.pPlan      = pPlan;
+        load_task.pBin_dir   = pBin_dir;
+        load_task.pRom_crc   = pHeader->pRom_crc;
+        load_task.pAes       = (pHeader->bEnable_AES) ? pAes : 0;
+        load_task.pIv_key    = pIv_key;
+        load_task.pAes_iv    = pHeader->pAes_iv;
+        if( (rval = task_pool__run(thread_num, (int)pPlan->rom_cnt, _image_load_task, &load_task)) )
+            break;
+
+        *ppImage = pImage;
+        pImage   = 0;
+    } while(0);
+
+    if( load_task.ppRom_name )  free(load_task.ppRom_name);
+    if( pImage )                free(pImage);
+
+    return rval;
+}
+
+/**
+ *  @brief  _flash_image__put_header
+ *              write the fw header and the AES info words to the head of the image
+ *
+ *  @param [in] pImage          the image of _flash_image__load()
+ *  @param [in] pHeader         the built fw header
+ *  @param [in] pPlan           the flash layout
+ *  @return
+ *      0: ok, others: fail
+ */
+static int
+_flash_image__put_header(
+    uint8_t         *pImage,
+    fw_header_t     *pHeader,
+    layout_plan_t   *pPlan)
+{
+    uint32_t        k;
+    uint32_t        word_cnt = pHeader->word_cnt + pHeader->aes_word_cnt;
+    uint32_t        *pWords = pHeader->pWords;
+
+    if( (word_cnt << 2) > pPlan->alignment )
+    {
+        err_msg("fw header (0x%x bytes) is larger than the alignment 0x%x \n", word_cnt << 2, pPlan->alignment);
+        return -1;
+    }
+
+    // the words are little endian as the DCD of armasm
+    for(k = 0; k < word_cnt; k++)
+    {
+        pImage[(k << 2)]     = (uint8_t)(pWords[k]);
+        pImage[(k << 2) + 1] = (uint8_t)(pWords[k] >> 8);
+        pImage[(k << 2) + 2] = (uint8_t)(pWords[k] >> 16);
+        pImage[(k << 2) + 3] = (uint8_t)(pWords[k] >> 24);
+    }
+
+    return 0;
+}
+
+static int
+_output_flash_image(
+    fw_info_t       *pFw_info,
+    int             fw_cnt,
+    layout_plan_t   *pPlan,
+    const char      *pOut_path,
+    out_args_t      *pArgs)
+{
+    return _commit_output(pOut_path, (char*)pArgs->flash_image.pImage,
+                          (long)(pPlan->end_addr - pPlan->flash_start_addr), pArgs->is_force_write, 1);
+}
+
+typedef struct delta_task
+{
+    const uint8_t   *pImage;
+    uint32_t        image_size;
+    const uint8_t   *pBase;
+    uint32_t        base_size;
+    uint32_t        sector_size;
+
+    uint8_t         *pIs_changed;   // one item a sector
+    uint32_t        *pBase_crc;
+    uint32_t        *pCrc;
+
+} delta_task_t;
+
+static int
+_delta_task(void *pTask_info, int task_idx)
+{
+    delta_task_t    *pTask = (delta_task_t*)pTask_info;
+    uint32_t        offset = (uint32_t)task_idx * pTask->sector_size;
+    uint32_t        size = (pTask->image_size - offset < pTask->sector_size) ? pTask->image_size - offset : pTask->sector_size;
+    uint32_t        base_size = (offset >= pTask->base_size) ? 0
+                              : (pTask->base_size - offset < size) ? pTask->base_size - offset : size;
+
+    pTask->pIs_changed[task_idx] = (base_size != size || memcmp(pTask->pImage + offset, pTask->pBase + offset, size));
+    if( !pTask->pIs_changed[task_idx] )
+        return 0;
+
+    pTask->pBase_crc[task_idx] = crc32__final(crc32__update(crc32__init(), pTask->pBase + offset, base_size));
+    pTask->pCrc[task_idx]      = crc32__final(crc32__update(crc32__init(), pTask->pImage + offset, size));
+    return 0;
+}
+
+/**
+ *  @brief  _output_flash_delta
+ *              the changed erase sectors (fw_aligmnet) of the image from the base image,
+ *              no base image (the first build) gives all sectors
+ */
+static int
+_output_flash_delta(
+    fw_info_t       *pFw_info,
+    int             fw_cnt,
+    layout_plan_t   *pPlan,
+    const char      *pOut_path,
+    out_args_t      *pArgs)
+{
+    int             rval = 0;
+    uint32_t        i;
+    uint32_t        image_size = pPlan->end_addr - pPlan->flash_start_addr;
+    uint32_t        sector_cnt = (image_size + pPlan->alignment - 1) / pPlan->alignment;
+    uint32_t        changed_cnt = 0, changed_size = 0;
+    uint8_t         *pBase = 0;
+    long            base_size = 0;
+    FILE            *fin = 0;
+    delta_task_t    delta_task = {0};
+    str_builder_t   hStr;
+
+    str_builder__init(&hStr, STRING_BUF_INIT_SIZE);
+
+    do {
+        // a missing base is an empty flash, all the sectors are sent
+        if( (fin = fopen(pArgs->flash_delta.pBase_path, "rb")) )
+        {
+            uint32_t    size = 0;
+
+            fseek(fin, 0, SEEK_END);
+            base_size = ftell(fin);
+            fclose(fin);
+
+            if( base_size < 0 || base_size > 0x7FFFFFFF ||
+                !(pBase = malloc((size_t)base_size + 1)) )
+            {
+                rval = -1;
+                err_msg("load base image %s fail \n", pArgs->flash_delta.pBase_path);
+                break;
+            }
+
+            if( (rval = _load_bin(pArgs->flash_delta.pBase_path, pBase, (uint32_t)base_size, &size)) )
+                break;
+
+            base_size = (long)size;
+        }
+        else
+            fprintf(stderr, "no base image %s, the delta has all sectors\n", pArgs->flash_delta.pBase_path);
+
+        if( !(delta_task.pIs_changed = malloc(sector_cnt + 1)) ||
+            !(delta_task.pBase_crc = malloc((sector_cnt + 1) * sizeof(uint32_t))) ||
+            !(delta_task.pCrc = malloc((sector_cnt + 1) * sizeof(uint32_t))) )
+        {
+            rval = -1;
+            err_msg("malloc %u sectors fail \n", sector_cnt);
+            break;
+        }
+
+        delta_task.pImage      = pArgs->flash_delta.pImage;
+        delta_task.image_size  = image_size;
+        delta_task.pBase       = pBase;
+        delta_task.base_size   = (uint32_t)base_size;
+        delta_task.sector_size = pPlan->alignment;
+        if( (rval = task_pool__run(pArgs->flash_delta.thread_num, (int)sector_cnt, _delta_task, &delta_task)) )
+            break;
+
+        for(i = 0; i < sector_cnt; i++)
+        {
+            if( !delta_task.pIs_changed[i] )
+                continue;
+
+            changed_cnt++;
+            changed_size += (image_size - i * pPlan->alignment < pPlan->alignment)
+                          ? image_size - i * pPlan->alignment : pPlan->alignment;
+        }
+
+        str_builder__reserve(&hStr, (FLASH_DELTA_HEADER_MEMBER_CNT + changed_cnt * FLASH_DELTA_SECTOR_MEMBER_CNT) * 4 + changed_size);
+
+        _put_le32(&hStr, FLASH_DELTA_MAGIC);
+        _put_le32(&hStr, FLASH_DELTA_VERSION);
+        _put_le32(&hStr, pPlan->flash_start_addr);
+        _put_le32(&hStr, pPlan->alignment);
+        _put_le32(&hStr, (uint32_t)base_size);
+        _put_le32(&hStr, crc32__final(crc32__update(crc32__init(), pBase, (size_t)base_size)));
+        _put_le32(&hStr, image_size);
+        _put_le32(&hStr, crc32__final(crc32__update(crc32__init(), pArgs->flash_delta.pImage, image_size)));
+        _put_le32(&hStr, changed_cnt);
+
+        for(i = 0; i < sector_cnt; i++)
+        {
+            uint32_t    offset = i * pPlan->alignment;
+            uint32_t    size = (image_size - offset < pPlan->alignment) ? image_size - offset : pPlan->alignment;
+
+            if( !delta_task.pIs_changed[i] )
+                continue;
+
+            _put_le32(&hStr, offset);
+            _put_le32(&hStr, size);
+            _put_le32(&hStr, delta_task.pBase_crc[i]);
+            _put_le32(&hStr, delta_task.pCrc[i]);
+            str_builder__append(&hStr, (const char*)pArgs->flash_delta.pImage + offset, size);
+        }
+
+        if( hStr.is_fail )
+        {
+            rval = -1;
+            err_msg("malloc delta (0x%x bytes) fail \n", changed_size);
+            break;
+        }
+
+        fprintf(stderr, "flash delta: %u of %u sectors changed (0x%x bytes)\n", changed_cnt, sector_cnt, changed_size);
+
+        rval = _commit_output(pOut_path, hStr.pBuf, (long)hStr.len, pArgs->is_force_write, 1);
+    } while(0);
+
+    if( delta_task.pIs_changed )    free(delta_task.pIs_changed);
+    if( delta_task.pBase_crc )      free(delta_task.pBase_crc);
+    if( delta_task.pCrc )           free(delta_task.pCrc);
+    if( pBase )                     free(pBase);
+
+    str_builder__release(&hStr);
+    return rval;
+}
+
+static void
+_push_ihex_record(
+    str_builder_t   *pHStr,
+    uint8_t         type,
+    uint16_t        addr,
+    const uint8_t   *pData,
+    int             len)
+{
+    int         i;
+    char        line[IHEX_RECORD_MAX_LEN];
+    char        *pCur = line;
+    uint8_t     sum = (uint8_t)(len + (addr >> 8) + addr + type);
+
+    *pCur++ = ':';
+    PUSH_HEX_BYTE(pCur, len);
+    PUSH_HEX_BYTE(pCur, addr >> 8);
+    PUSH_HEX_BYTE(pCur, addr);
+    PUSH_HEX_BYTE(pCur, type);
+
+    for(i = 0; i < len; i++)
+    {
+        PUSH_HEX_BYTE(pCur, pData[i]);
+        sum += pData[i];
+    }
+
+    sum = (uint8_t)(0x100 - sum);
+    PUSH_HEX_BYTE(pCur, sum);
+    *pCur++ = '\n';
+
+    str_builder__append(pHStr, line, pCur - line);
+    return;
+}
+
+/**
+ *  @brief  _output_flash_hex
+ *              the flash image in Intel HEX, 32-bit addresses with the extended linear address records
+ */
+static int
+_output_flash_hex(
+    fw_info_t       *pFw_info,
+    int             fw_cnt,
+    layout_plan_t   *pPlan,
+    const char      *pOut_path,
+    out_args_t      *pArgs)
+{
+    int             rval = 0;
+    uint32_t        offset = 0;
+    uint32_t        image_size = pPlan->end_addr - pPlan->flash_start_addr;
+    uint32_t        upper_addr = 0;
+    uint8_t         *pImage = pArgs->flash_image.pImage;
+    str_builder_t   hStr;
+
+    str_builder__init(&hStr, STRING_BUF_INIT_SIZE);
+    str_builder__reserve(&hStr, (image_size / IHEX_DATA_LEN + 2) * IHEX_RECORD_MAX_LEN);
+
+    while( offset < image_size )
+    {
+        uint32_t    addr = pPlan->flash_start_addr + offset;
+        uint32_t    len = (image_size - offset < IHEX_DATA_LEN) ? image_size - offset : IHEX_DATA_LEN;
+
+        if( !offset || (addr >> 16) != upper_addr )
+        {
+            uint8_t     upper[2];
+
+            upper_addr = addr >> 16;
+            upper[0]   = (uint8_t)(upper_addr >> 8);
+            upper[1]   = (uint8_t)(upper_addr);
+            _push_ihex_record(&hStr, 0x04, 0, upper, 2);
+        }
+
+        // a record does not cross a 64KB boundary
+        len = (0x10000 - (addr & 0xFFFF) < len) ? 0x10000 - (addr & 0xFFFF) : len;
+
+        _push_ihex_record(&hStr, 0x00, (uint16_t)addr, pImage + offset, (int)len);
+        offset += len;
+    }
+
+    _push_ihex_record(&hStr, 0x01, 0, 0, 0);
+
+    rval = _commit_text(pOut_path, &hStr, pArgs->is_force_write);
+
+    str_builder__release(&hStr);
+    return rval;
+}
+
+static void
+_push_srec_record(
+    str_builder_t   *pHStr,
+    char            type,
+    int             addr_len,
+    uint32_t        addr,
+    const uint8_t   *pData,
+    int             len)
+{
+    int         i;
+    char        line[SREC_RECORD_MAX_LEN];
+    char        *pCur = line;
+    uint8_t     sum = (uint8_t)(addr_len + len + 1);
+
+    *pCur++ = 'S';
+    *pCur++ = type;
+    PUSH_HEX_BYTE(pCur, addr_len + len + 1);
+
+    for(i = addr_len - 1; i >= 0; i--)
+    {
+        uint8_t     value = (uint8_t)(addr >> (i << 3));
+
+        PUSH_HEX_BYTE(pCur, value);
+        sum += value;
+    }
+
+    for(i = 0; i < len; i++)
+    {
+        PUSH_HEX_BYTE(pCur, pData[i]);
+        sum += pData[i];
+    }
+
+    sum = (uint8_t)~sum;
+    PUSH_HEX_BYTE(pCur, sum);
+    *pCur++ = '\n';
+
+    str_builder__append(pHStr, line, pCur - line);
+    return;
+}
+
+/**
+ *  @brief  _output_flash_srec
+ *              the flash image in Motorola S-record, S3 data records and the S7 start address
+ */
+static int
+_output_flash_srec(
+    fw_info_t       *pFw_info,
+    int             fw_cnt,
+    layout_plan_t   *pPlan,
+    const char      *pOut_path,
+    out_args_t      *pArgs)
+{
+    int             rval = 0;
+    uint32_t        offset = 0;
+    uint32_t        record_cnt = 0;
+    uint32_t        image_size = pPlan->end_addr - pPlan->flash_start_addr;
+    uint8_t         *pImage = pArgs->flash_image.pImage;
+    str_builder_t   hStr;
+
+    str_builder__init(&hStr, STRING_BUF_INIT_SIZE);
+    str_builder__reserve(&hStr, (image_size / SREC_DATA_LEN + 4) * SREC_RECORD_MAX_LEN);
+
+    _push_srec_record(&hStr, '0', 2, 0, 0, 0);
+
+    for(; offset < image_size; offset += SREC_DATA_LEN, record_cnt++)
+    {
+        uint32_t    len = (image_size - offset < SREC_DATA_LEN) ? image_size - offset : SREC_DATA_LEN;
+
+        _push_srec_record(&hStr, '3', 4, pPlan->flash_start_addr + offset, pImage + offset, (int)len);
+    }
+
+    // the record count is optional, S5 (16 bits) or S6 (24 bits)
+    if( record_cnt <= 0xFFFF )
+        _push_srec_record(&hStr, '5', 2, record_cnt, 0, 0);
+    else if( record_cnt <= 0xFFFFFF )
+        _push_srec_record(&hStr, '6', 3, record_cnt, 0, 0);
+
+    _push_srec_record(&hStr, '7', 4, pPlan->flash_start_addr, 0, 0);
+
+    rval = _commit_text(pOut_path, &hStr, pArgs->is_force_write);
+
+    str_builder__release(&hStr);
+    return rval;
+}
+
+static void
+_put_elf32_shdr(
+    str_builder_t   *pHStr,
+    uint32_t        name,
+    uint32_t        type,
+    uint32_t        flags,
+    uint32_t        addr,
+    uint32_t        offset,
+    uint32_t        size)
+{
+    _put_le32(pHStr, name);
+    _put_le32(pHStr, type);
+    _put_le32(pHStr, flags);
+    _put_le32(pHStr, addr);
+    _put_le32(pHStr, offset);
+    _put_le32(pHStr, size);
+    _put_le32(pHStr, 0);    // link
+    _put_le32(pHStr, 0);    // info
+    _put_le32(pHStr, (type) ? 1 : 0);   // address alignment
+    _put_le32(pHStr, 0);    // entry size
+    return;
+}
+
+/**
+ *  @brief  _output_flash_elf
+ *              the flash image in ELF32 (ARM, little endian), one PT_LOAD segment at the flash start address,
+ *              the sections: null, .fwimage, .shstrtab
+ */
+static int
+_output_flash_elf(
+    fw_info_t       *pFw_info,
+    int             fw_cnt,
+    layout_plan_t   *pPlan,
+    const char      *pOut_path,
+    out_args_t      *pArgs)
+{
+    int             rval = 0;
+    uint32_t        image_size = pPlan->end_addr - pPlan->flash_start_addr;
+    // the file offset of the segment is congruent to its address (p_align 4)
+    uint32_t        data_offset = ELF32_EHDR_SIZE + ELF32_PHDR_SIZE + (pPlan->flash_start_addr & 0x3);
+    uint32_t        shstrtab_offset = data_offset + image_size;
+    uint32_t        shdr_offset = (shstrtab_offset + ELF32_SHSTRTAB_SIZE + 0x3) & ~0x3;
+    const char      ident[16] = { 0x7F, 'E', 'L', 'F', 1, 1, 1, 0 };   // 32-bit, little endian, version 1
+    str_builder_t   hStr;
+
+    str_builder__init(&hStr, STRING_BUF_INIT_SIZE);
+    str_builder__reserve(&hStr, shdr_offset + 3 * ELF32_SHDR_SIZE);
+
+    // ELF header
+    str_builder__append(&hStr, ident, sizeof(ident));
+    _put_le16(&hStr, 2);                        // ET_EXEC
+    _put_le16(&hStr, ELF32_EM_ARM);
+    _put_le32(&hStr, 1);                        // EV_CURRENT
+    _put_le32(&hStr, 0);                        // entry
+    _put_le32(&hStr, ELF32_EHDR_SIZE);          // program header offset
+    _put_le32(&hStr, shdr_offset);
+    _put_le32(&hStr, ELF32_EF_ARM_EABI_VER5);
+    _put_le16(&hStr, ELF32_EHDR_SIZE);
+    _put_le16(&hStr, ELF32_PHDR_SIZE);
+    _put_le16(&hStr, 1);
+    _put_le16(&hStr, ELF32_SHDR_SIZE);
+    _put_le16(&hStr, 3);
+    _put_le16(&hStr, 2);                        // the index of .shstrtab
+
+    // program header
+    _put_le32(&hStr, 1);                        // PT_LOAD
+    _put_le32(&hStr, data_offset);
+    _put_le32(&hStr, pPlan->flash_start_addr);  // virtual address
+    _put_le32(&hStr, pPlan->flash_start_addr);  // physical address
+    _put_le32(&hStr, image_size);
+    _put_le32(&hStr, image_size);
+    _put_le32(&hStr, 0x4);                      // PF_R
+    _put_le32(&hStr, 0x4);
+
+    str_builder__append(&hStr, "\0\0\0", pPlan->flash_start_addr & 0x3);
+    str_builder__append(&hStr, (const char*)pArgs->flash_image.pImage, image_size);
+    str_builder__append(&hStr, ELF32_SHSTRTAB, ELF32_SHSTRTAB_SIZE);
+    str_builder__append(&hStr, "\0\0\0", shdr_offset - shstrtab_offset - ELF32_SHSTRTAB_SIZE);
+
+    // section headers
+    _put_elf32_shdr(&hStr, 0, 0, 0, 0, 0, 0);
+    _put_elf32_shdr(&hStr, 1, 1, 0x2, pPlan->flash_start_addr, data_offset, image_size);     // PROGBITS, ALLOC
+    _put_elf32_shdr(&hStr, 10, 3, 0, 0, shstrtab_offset, ELF32_SHSTRTAB_SIZE);                // STRTAB
+
+    if( hStr.is_fail )
+    {
+        rval = -1;
+        err_msg("malloc elf (0x%x bytes) fail \n", shdr_offset);
+    }
+    else
+        rval = _commit_output(pOut_path, hStr.pBuf, (long)hStr.len, pArgs->is_force_write, 1);
+
+    str_builder__release(&hStr);
+    return rval;
+}
+
+/**
+ *  @brief  _fw_info__diff
+ *              the outputs affected by the new records of a map file
+ *
+ *  @param [in] pOld            the previous records
+ *  @param [in] pNew            the new records
+ *  @return
+ *      the mask of out_file_t
+ */
+static uint32_t
+_fw_info__diff(
+    fw_info_t   *pOld,
+    fw_info_t   *pNew)
+{
+    uint32_t    i;
+    uint32_t    out_mask = 0;
+
+    if( pOld->rom_cnt != pNew->rom_cnt || pOld->fw_uid != pNew->fw_uid )
+        return OUT_FILE_MASK_ALL;
+
+    for(i = 0; i < pNew->rom_cnt; i++)
+    {
+        if( strcmp(pOld->pRom_name[i], pNew->pRom_name[i]) )
+            out_mask |= (0x1 << OUT_FILE_ROM_MERGE_LIST) | (0x1 << OUT_FILE_FW_HEADER);
+
+        if( pOld->pBase_addr[i] != pNew->pBase_addr[i] )
+            out_mask |= (0x1 << OUT_FILE_FW_HEADER);
+
+        if( pOld->pRom_size[i] != pNew->pRom_size[i] )
+            out_mask |= (0x1 << OUT_FILE_ROM_MERGE_LIST) | (0x1 << OUT_FILE_FW_HEADER) | (0x1 << OUT_FILE_END_PADDING);
+    }
+
+    // the image has the fw header
+    if( out_mask & (0x1 << OUT_FILE_FW_HEADER) )
+        out_mask |= (0x1 << OUT_FILE_FLASH_IMAGE);
+
+    return out_mask;
+}
+
+static int
+_load_config(
+    gen_ctx_t   *pCtx)
+{
+    int         rval = 0;
+    const char  *pPath = 0;
+
+    do {
+        pCtx->pIni = iniparser_load(pCtx->pIni_path);
+        if( pCtx->pIni == NULL )
+        {
+            err_msg("cannot parse file: '%s'\n", pCtx->pIni_path);
+            rval = -1;
+            break;
+        }
+
+        pCtx->map_file_cnt = iniparser_getint(pCtx->pIni, "in_file:map_file_cnt", 0);
+
+        // the emitters rewrite target_bin_dir with '\', keep the native one for watching
+        pPath = iniparser_getstring(pCtx->pIni, "bin:target_bin_dir", NULL);
+        if( pPath && !(pCtx->pBin_dir = malloc(strlen(pPath) + 1)) )
+        {
+            rval = -1;
+            err_msg("malloc %d fail \n", strlen(pPath) + 1);
+            break;
+        }
+        if( pPath )
+            snprintf(pCtx->pBin_dir, strlen(pPath) + 1, "%s", pPath);
+
+        /**
+         *  the records of the unchanged map files are loaded from the parse cache,
+         *  --verify-parser always parses
+         */
+        pPath = iniparser_getstring(pCtx->pIni, "cache:parse_cache_path", NULL);
+        if( pPath && !pCtx->is_cache_off && pCtx->parser != MAP_PARSER_VERIFY )
+            parse_cache__load(&pCtx->hCache, pPath);
+
+    } while(0);
+
+    return rval;
+}
+
+static void
+_release_config(
+    gen_ctx_t   *pCtx)
+{
+    arena__destroy(pCtx->pArena);
+
+    if( pCtx->pBin_dir )    free(pCtx->pBin_dir);
+    if( pCtx->pIni )        iniparser_freedict(pCtx->pIni);
+
+    parse_cache__release(&pCtx->hCache);
+
+    pCtx->pIni         = 0;
+    pCtx->pBin_dir     = 0;
+    pCtx->pArena       = 0;
+    pCtx->pFw_info     = 0;
+    pCtx->map_file_cnt = 0;
+    return;
+}
+
+/**
+ *  @brief  _parse_maps
+ *              (re-)parse the selected map files and replace their records.
+ *              All the records move to a new arena, the old one is destroyed at once.
+ *
+ *  @param [in] pCtx            the generator context
+ *  @param [in] pIs_selected    the map files to parse (map_file_cnt items)
+ *  @param [in] pOut_mask       report the outputs affected by the new records (out_file_t mask)
+ *  @return
+ *      0: ok, others: fail
+ */
+static int
+_parse_maps(
+    gen_ctx_t       *pCtx,
+    const uint8_t   *pIs_selected,
+    uint32_t        *pOut_mask)
+{
+    int                 rval = 0;
+    int                 i;
+    int                 stdin_cnt = 0;
+    int                 map_file_cnt = pCtx->map_file_cnt;
+    char                str_buf[MAX_STR_LEN] = {0};
+    const char          *pPath = 0;
+    partial_read_t      *pHReader = 0;
+    arena_t             *pNew_arena = 0;
+    fw_info_t           *pNew_fw_info = 0;
+    int                 *pCache_state = 0;
+    parse_cache_key_t   *pCache_keys = 0;
+    parse_cache_t       *pHCache = &pCtx->hCache;
+
+    do {
+        if( !(pNew_arena = arena__create(0)) ||
+            !(pNew_fw_info = arena__alloc(pNew_arena, map_file_cnt * sizeof(fw_info_t) + 1)) ||
+            !(pHReader = malloc(map_file_cnt * sizeof(partial_read_t) + 1)) ||
+            !(pCache_state = malloc(map_file_cnt * sizeof(int) + 1)) ||
+            !(pCache_keys = malloc(map_file_cnt * sizeof(parse_cache_key_t) + 1)) )
+        {
+            rval = -1;
+            err_msg("malloc %d fail \n", map_file_cnt * sizeof(partial_read_t));
+            break;
+        }
+        memset(pHReader, 0x0, map_file_cnt * sizeof(partial_read_t));
+        memset(pNew_fw_info, 0x0, map_file_cnt * sizeof(fw_info_t));
+
+        for(i = 0; i < map_file_cnt; i++)
+            pNew_fw_info[i].pArena = pNew_arena;
+        memset(pCache_keys, 0x0, map_file_cnt * sizeof(parse_cache_key_t));
+
+        for(i = 0; i < map_file_cnt; i++)
+        {
+            fw_info_t       *pCur_fw_info = &pNew_fw_info[i];
+
+            pCache_state[i] = -1;
+
+            if( !pIs_selected[i] )
+            {
+                // keep the records of the last parsing
+                if( pCtx->pFw_info && (rval = _fw_info__clone(pCur_fw_info, &pCtx->pFw_info[i])) )
+                {
+                    err_msg("clone fw info %d fail !\n", i);
+                    break;
+                }
+                continue;
+            }
+
+            snprintf(str_buf, MAX_STR_LEN, "in_file:keil_map_file_path_%d", i);
+            pPath = iniparser_getstring(pCtx->pIni, str_buf, NULL);
+            if( !pPath )
+            {
+                rval = -1;
+                err_msg("no '%s' file !\n", str_buf);
+                break;
+            }
+
+            if( !strcmp(pPath, STDIN_PATH) && stdin_cnt++ )
+            {
+                rval = -1;
+                err_msg("only one map file can be read from stdin ('%s')\n", str_buf);
+                break;
+            }
+
+            snprintf(str_buf, MAX_STR_LEN, "in_file:fw_mark_%d", i);
+            pCur_fw_info->fw_uid = strtoul(iniparser_getstring(pCtx->pIni, str_buf, NULL), NULL, 16);
+
+            if( pHCache->pCache_path && strcmp(pPath, STDIN_PATH) )
+            {
+                parse_cache_entry_t     *pEntry = 0;
+
+                pCache_state[i] = parse_cache__lookup(pHCache, pPath, &pCache_keys[i], &pEntry);
+                if( !pCache_state[i] )
+                    rval = _fw_info__from_cache(pCur_fw_info, pEntry);
+            }
+
+            if( !rval && pCache_state[i] )
+                rval = _create_reader(pHReader + i, pPath);
+
+            if( rval )  break;
+        }
+
+        if( rval )  break;
+
+        {   // parse the map files, -j N parses them (and the chunks of a large one) at the same time
+            parse_task_t    parse_task = {0};
+
+            parse_task.pHReader     = pHReader;
+            parse_task.pFw_info     = pNew_fw_info;
+            parse_task.pIs_selected = pIs_selected;
+            parse_task.parser       = pCtx->parser;
+            parse_task.pCache_state = pCache_state;
+
+            // the threads left by a few map files split the large ones
+            parse_task.chunk_thread_num = (map_file_cnt > 0 && map_file_cnt < pCtx->thread_num)
+                                        ? pCtx->thread_num / map_file_cnt : 1;
+
+            if( (rval = task_pool__run(pCtx->thread_num, map_file_cnt, _parse_task, &parse_task)) )
+                break;
+        }
+
+        if( pHCache->pCache_path )
+        {
+            for(i = 0; i < map_file_cnt; i++)
+            {
+                // a new or changed map file
+                if( pCache_state[i] != 1 )
+                    continue;
+
+                snprintf(str_buf, MAX_STR_LEN, "in_file:keil_map_file_path_%d", i);
+                _fw_info__to_cache(&pNew_fw_info[i], pHCache, iniparser_getstring(pCtx->pIni, str_buf, NULL), &pCache_keys[i]);
+            }
+
+            parse_cache__save(pHCache);
+        }
+
+        if( pOut_mask && pCtx->pFw_info )
+        {
+            for(i = 0; i < map_file_cnt; i++)
+            {
+                if( pIs_selected[i] )
+                    *pOut_mask |= _fw_info__diff(&pCtx->pFw_info[i], &pNew_fw_info[i]);
+            }
+        }
+
+        // replace all the records, the fw array keeps the ini order
+        arena__destroy(pCtx->pArena);
+        pCtx->pArena   = pNew_arena;
+        pCtx->pFw_info = pNew_fw_info;
+        pNew_arena     = 0;
+    } while(0);
+
+    if( pHReader )
+    {
+        for(i = 0; i < map_file_cnt; i++)
+            _destroy_reader(pHReader + i);
+
+        free(pHReader);
+    }
+
+    arena__destroy(pNew_arena);
+
+    if( pCache_state )  free(pCache_state);
+    if( pCache_keys )   free(pCache_keys);
+
+    return rval;
+}
+
+static int
+_emit_outputs(
+    gen_ctx_t   *pCtx,
+    uint32_t    out_mask,
+    uint32_t    force_mask)
+{
+    int             rval = 0;
+    dictionary      *pIni = pCtx->pIni;
+    fw_info_t       *pFw_info = pCtx->pFw_info;
+    layout_plan_t   layout_plan = {0};
+    fw_header_t     fw_header = {0};    // FwHeader.s, armasm links it with the plain bin files
+    fw_header_t     image_header = {0}; // the head of the flash image outputs and fw_header_bin_path
+    uint8_t         *pImage = 0;
+    aes_ctx_t       aes_ctx;
+    uint8_t         aes_key[AES_KEY_SIZE] = {0};
+    uint8_t         aes_iv_key[AES_KEY_SIZE] = {0};
+    arena_t         *pEmit_arena = 0;   // the plan, the rom crc and the IV of this emitting
+
+    do {
+        char        str_buf[MAX_STR_LEN] = {0};
+        const char  *pPath = 0;
+        char        *pTmp = 0;
+        out_args_t  out_args = {0};
+        uint32_t    alignment = iniparser_getint(pIni, "flash:fw_aligmnet", 0);
+        uint32_t    pack_alignment = 0;
+        const char  *pHex_path = iniparser_getstring(pIni, "out_file:flash_hex_path", NULL);
+        const char  *pSrec_path = iniparser_getstring(pIni, "out_file:flash_srec_path", NULL);
+        const char  *pElf_path = iniparser_getstring(pIni, "out_file:flash_elf_path", NULL);
+        int         is_image_out = (iniparser_getstring(pIni, "out_file:flash_image_path", NULL) ||
+                                    pHex_path || pSrec_path || pElf_path);
+
+        pPath = iniparser_getstring(pIni, "flash:fw_placement", "compat");
+        if( !strcmp(pPath, "packed") )
+        {
+            if( !(pack_alignment = iniparser_getint(pIni, "flash:fw_pack_alignment", alignment)) )
+            {
+                rval = -1;
+                err_msg("%s\n", "fw_pack_alignment is 0 !");
+                break;
+            }
+        }
+        else if( strcmp(pPath, "compat") )
+        {
+            rval = -1;
+            err_msg("unknown fw_placement '%s' (compat or packed)\n", pPath);
+            break;
+        }
+
+        // pCtx->pArena lives with the records, a bin change or a retry of --watch emits without parsing
+        if( !(pEmit_arena = arena__create(EMIT_ARENA_BLOCK_SIZE)) )
+        {
+            rval = -1;
+            err_msg("%s\n", "create emit arena fail !");
+            break;
+        }
+
+        rval = _layout__plan(&layout_plan, pEmit_arena, pFw_info, pCtx->map_file_cnt,
+                             strtoul(iniparser_getstring(pIni, "flash:fw_start_addr", NULL), NULL, 16),
+                             alignment, pack_alignment);
+        if( rval )  break;
+
+        if( layout_plan.pack_alignment )
+        {
+            uint32_t    size = layout_plan.end_addr - layout_plan.flash_start_addr;
+            uint32_t    compat_size = layout_plan.compat_end_addr - layout_plan.flash_start_addr;
+
+            fprintf(stderr, "packed placement: 0x%x bytes (%u sectors), saved 0x%x bytes (%u sectors)\n",
+                    size, (size + alignment - 1) / alignment,
+                    compat_size - size,
+                    (compat_size + alignment - 1) / alignment - (size + alignment - 1) / alignment);
+        }
+
+        if( out_mask & ((0x1 << OUT_FILE_FW_HEADER) | (0x1 << OUT_FILE_FLASH_IMAGE)) )
+        {
+            int     is_md5 = iniparser_getboolean(pIni, "tag:enable_md5", 0);
+            int     is_image_header = (is_image_out || iniparser_getstring(pIni, "out_file:fw_header_bin_path", NULL));
+
+            // the md5 is only right for the image of this tool, the flash of armasm has other pads
+            if( is_md5 && !is_image_header )
+            {
+                rval = -1;
+                err_msg("%s\n", "the md5 needs a flash image output or fw_header_bin_path !");
+                break;
+            }
+
+            memcpy(fw_header.host_mark,
+                   iniparser_getstring(pIni, "tag:host_mark", "unknown"),
+                   sizeof(fw_header.host_mark));
+
+            fw_header.uid_mark_0 = strtoul(iniparser_getstring(pIni, "tag:uid_mark_0", NULL), NULL, 16);
+            fw_header.uid_mark_1 = strtoul(iniparser_getstring(pIni, "tag:uid_mark_1", NULL), NULL, 16);
+
+            image_header = fw_header;
+
+            // the rom crc is the flash space of this tool (pad_byte), only in the image header
+            if( iniparser_getboolean(pIni, "tag:enable_rom_crc32", 0) )
+            {
+                if( !is_image_header )
+                {
+                    rval = -1;
+                    err_msg("%s\n", "the rom crc32 needs a flash image output or fw_header_bin_path !");
+                    break;
+                }
+
+                if( !(image_header.pRom_crc = arena__alloc(pEmit_arena, (layout_plan.rom_cnt + 1) * sizeof(uint32_t))) )
+                {
+                    rval = -1;
+                    err_msg("malloc %u rom crc fail \n", layout_plan.rom_cnt);
+                    break;
+                }
+            }
+
+            // the encrypted roms are only in the flash image, the rom merge list and FwHeader.s take the plain bin files
+            pPath = iniparser_getstring(pIni, "aes:key_file", NULL);
+            if( pPath )
+            {
+                if( !is_image_out )
+                {
+                    rval = -1;
+                    err_msg("%s\n", "the AES encryption needs a flash image output (out_file:flash_image_path, ...) !");
+                    break;
+                }
+
+                if( (rval = _load_aes_key(pPath, aes_key)) )
+                    break;
+
+                if( !(image_header.pAes_iv = arena__alloc(pEmit_arena, (layout_plan.rom_cnt + 1) * AES_BLOCK_SIZE)) )
+                {
+                    rval = -1;
+                    err_msg("malloc %u AES IV fail \n", layout_plan.rom_cnt);
+                    break;
+                }
+
+                aes__init(&aes_ctx, aes_key);
+                image_header.bEnable_AES = 1;
+
+                // AES_K(label), the keystream of a zero block
+                aes__ctr_crypt(&aes_ctx, (const uint8_t*)AES_IV_KEY_LABEL, aes_iv_key, AES_KEY_SIZE);
+            }
+
+            // the md5, the rom crc, the AES IV and the flash image need the bin files
+            if( is_md5 || image_header.pRom_crc || image_header.bEnable_AES ||
+                ((out_mask & (0x1 << OUT_FILE_FLASH_IMAGE)) && is_image_out) )
+            {
+                if( !pCtx->pBin_dir )
+                {
+                    rval = -1;
+                    err_msg("%s\n", "no 'bin:target_bin_dir' for the flash image !");
+                    break;
+                }
+
+                rval = _flash_image__load(pFw_info, pCtx->map_file_cnt, &layout_plan, pCtx->pBin_dir,
+                                          (uint8_t)strtoul(iniparser_getstring(pIni, "bin:pad_byte", "FF"), NULL, 16),
+                                          pCtx->thread_num, &image_header, &aes_ctx, aes_iv_key, &pImage);
+                if( rval )  break;
+            }
+
+            // the md5 of the payload (the roms, the pads and the end mark) after the fw header space
+            if( is_md5 )
+            {
+                md5_ctx_t   md5_ctx;
+                uint8_t     digest[MD5_DIGEST_SIZE] = {0};
+                int         k;
+
+                md5__init(&md5_ctx);
+                md5__update(&md5_ctx, pImage + layout_plan.alignment,
+                            layout_plan.end_addr - layout_plan.flash_start_addr - layout_plan.alignment);
+                md5__final(&md5_ctx, digest);
+
+                // the DCD words are little endian, the digest bytes stay in order in flash
+                for(k = 0; k < 4; k++)
+                {
+                    image_header.md5[k] = (uint32_t)digest[k * 4] | ((uint32_t)digest[k * 4 + 1] << 8) |
+                                          ((uint32_t)digest[k * 4 + 2] << 16) | ((uint32_t)digest[k * 4 + 3] << 24);
+                }
+            }
+
+            if( (rval = _fw_header__build(&fw_header, pFw_info, pCtx->map_file_cnt, &layout_plan)) )
+                break;
+
+            if( (rval = _fw_header__build(&image_header, pFw_info, pCtx->map_file_cnt, &layout_plan)) )
+                break;
+        }
+
+        //--------------------------------
+        if( out_mask & (0x1 << OUT_FILE_ROM_MERGE_LIST) )
+        {
+            memset(&out_args, 0x0, sizeof(out_args));
+            out_args.is_force_write = !!(force_mask & (0x1 << OUT_FILE_ROM_MERGE_LIST));
+
+            pPath = (char*)iniparser_getstring(pIni, "bin:target_bin_dir", NULL);
+            out_args.rom_merge_list.pBin_dir = (char*)pPath;
+
+            while( (pTmp = strstr(pPath, "/")) )
+                *pTmp = '\\';
+
+            snprintf(str_buf, MAX_STR_LEN, "%s", "out_file:rom_merge_list_path");
+            pPath = iniparser_getstring(pIni, str_buf, NULL);
+            if( !pPath )
+            {
+                rval = -1;
+                err_msg("no '%s' file !\n", str_buf);
+                break;
+            }
+            if( (rval = _output_rom_merge_list(pFw_info, pCtx->map_file_cnt, &layout_plan, pPath, &out_args)) )
+                break;
+        }
+
+        //--------------------------------
+        if( out_mask & (0x1 << OUT_FILE_APP_BLD_HEADER) )
+        {
+            memset(&out_args, 0x0, sizeof(out_args));
+            out_args.is_force_write = !!(force_mask & (0x1 << OUT_FILE_APP_BLD_HEADER));
+            out_args.app_bld_header.flash_mem_bass_addr = strtoul(iniparser_getstring(pIni, "flash:flash_mem_bass_addr", NULL), NULL, 16);
+            out_args.app_bld_header.sram_mem_bass_addr  = strtoul(iniparser_getstring(pIni, "ram:sram_mem_bass_addr", NULL), NULL, 16);
+            out_args.app_bld_header.sram_mem_size       = strtoul(iniparser_getstring(pIni, "ram:sram_mem_size", NULL), NULL, 16);
+            snprintf(str_buf, MAX_STR_LEN, "%s", "out_file:app_bld_h_path");
+            pPath = iniparser_getstring(pIni, str_buf, NULL);
+            if( !pPath )
+            {
+                rval = -1;
+                err_msg("no '%s' file !\n", str_buf);
+                break;
+            }
+            if( (rval = _output_app_bld_header(pFw_info, pCtx->map_file_cnt, &layout_plan, pPath, &out_args)) )
+                break;
+        }
+
+        //--------------------------------
+        if( out_mask & (0x1 << OUT_FILE_FW_HEADER) )
+        {
+            memset(&out_args, 0x0, sizeof(out_args));
+            out_args.is_force_write    = !!(force_mask & (0x1 << OUT_FILE_FW_HEADER));
+            out_args.fw_header.pHeader = &fw_header;
+
+            snprintf(str_buf, MAX_STR_LEN, "%s", "out_file:fw_header_path");
+            pPath = iniparser_getstring(pIni, str_buf, NULL);
+            if( !pPath )
+            {
+                rval = -1;
+                err_msg("no '%s' file !\n", str_buf);
+                break;
+            }
+            if( (rval = _output_fw_header(pFw_info, pCtx->map_file_cnt, &layout_plan, pPath, &out_args)) )
+                break;
+
+            // optional, the header of the flash image without the assembler
+            out_args.fw_header.pHeader = &image_header;
+
+            pPath = iniparser_getstring(pIni, "out_file:fw_header_bin_path", NULL);
+            if( pPath && (rval = _output_fw_header_bin(pFw_info, pCtx->map_file_cnt, &layout_plan, pPath, &out_args)) )
+                break;
+        }
+
+        //--------------------------------
+        if( out_mask & (0x1 << OUT_FILE_END_PADDING) )
+        {
+            memset(&out_args, 0x0, sizeof(out_args));
+            out_args.is_force_write = !!(force_mask & (0x1 << OUT_FILE_END_PADDING));
+            snprintf(str_buf, MAX_STR_LEN, "%s", "out_file:fw_end_padding_s_path");
+            pPath = iniparser_getstring(pIni, str_buf, NULL);
+            if( !pPath )
+            {
+                rval = -1;
+                err_msg("no '%s' file !\n", str_buf);
+                break;
+            }
+            if( (rval = _output_end_padding_alignment(pFw_info, pCtx->map_file_cnt, &layout_plan, pPath, &out_args)) )
+                break;
+        }
+
+        //--------------------------------
+        // optional, the merged image without the assembler
+        if( (out_mask & (0x1 << OUT_FILE_FLASH_IMAGE)) && is_image_out )
+        {
+            const char  *pDelta_path = iniparser_getstring(pIni, "out_file:flash_delta_path", NULL);
+
+            if( (rval = _flash_image__put_header(pImage, &image_header, &layout_plan)) )
+                break;
+
+            pPath = iniparser_getstring(pIni, "out_file:flash_image_path", NULL);
+
+            // optional, the changed sectors from the image on the device (a fixed file, not the last run)
+            if( pPath && pDelta_path )
+            {
+                const char  *pBase_path = iniparser_getstring(pIni, "bin:base_image_path", NULL);
+
+                if( !pBase_path )
+                {
+                    rval = -1;
+                    err_msg("%s\n", "flash_delta_path needs 'bin:base_image_path' !");
+                    break;
+                }
+
+                // flash_image_path is rewritten by each run, the next delta would be empty
+                if( _is_same_file(pBase_path, pPath) )
+                {
+                    rval = -1;
+                    err_msg("base_image_path '%s' is flash_image_path !\n", pBase_path);
+                    break;
+                }
+
+                memset(&out_args, 0x0, sizeof(out_args));
+                out_args.is_force_write         = !!(force_mask & (0x1 << OUT_FILE_FLASH_IMAGE));
+                out_args.flash_delta.pBase_path = pBase_path;
+                out_args.flash_delta.pImage     = pImage;
+                out_args.flash_delta.thread_num = pCtx->thread_num;
+                if( (rval = _output_flash_delta(pFw_info, pCtx->map_file_cnt, &layout_plan, pDelta_path, &out_args)) )
+                    break;
+            }
+
+            memset(&out_args, 0x0, sizeof(out_args));
+            out_args.is_force_write        = !!(force_mask & (0x1 << OUT_FILE_FLASH_IMAGE));
+            out_args.flash_image.pImage    = pImage;
+
+            if( pPath && (rval = _output_flash_image(pFw_info, pCtx->map_file_cnt, &layout_plan, pPath, &out_args)) )
+                break;
+
+            // the programmer formats of the same image
+            if( pHex_path && (rval = _output_flash_hex(pFw_info, pCtx->map_file_cnt, &layout_plan, pHex_path, &out_args)) )
+                break;
+
+            if( pSrec_path && (rval = _output_flash_srec(pFw_info, pCtx->map_file_cnt, &layout_plan, pSrec_path, &out_args)) )
+                break;
+
+            if( pElf_path && (rval = _output_flash_elf(pFw_info, pCtx->map_file_cnt, &layout_plan, pElf_path, &out_args)) )
+                break;
+        }
+    } while(0);
+
+    if( fw_header.pWords )      free(fw_header.pWords);
+    if( image_header.pWords )   free(image_header.pWords);
+    if( pImage )                free(pImage);
+
+    arena__destroy(pEmit_arena);
+
+    // no key in the memory after the run
+    memset(&aes_ctx, 0x0, sizeof(aes_ctx));
+    memset(aes_key, 0x0, sizeof(aes_key));
+    memset(aes_iv_key, 0x0, sizeof(aes_iv_key));
+
+    return rval;
+}
+
+#if defined(__linux__)
+/**
+ *  watch the directory of a file, linkers and editors often replace the file (a new inode)
+ *
+ *  @return
+ *      the watch descriptor or -1
+ */
+static int
+_watch__add(
+    int         fd,
+    const char  *pPath,
+    int         is_dir,
+    const char  **ppName)
+{
+    char        dir_path[PATH_MAX] = {0};
+    const char  *pName = strrchr(pPath, '/');
+
+    *ppName = 0;
+
+    if( is_dir )
+        snprintf(dir_path, sizeof(dir_path), "%s", pPath);
+    else if( !pName )
+    {
+        snprintf(dir_path, sizeof(dir_path), "%s", ".");
+        *ppName = pPath;
+    }
+    else
+    {
+        snprintf(dir_path, sizeof(dir_path), "%.*s", (pName == pPath) ? 1 : (int)(pName - pPath), pPath);
+        *ppName = pName + 1;
+    }
+
+    return inotify_add_watch(fd, dir_path, WATCH_EVENT_MASK);
+}
+
+static int
+_watch_inputs(
+    gen_ctx_t   *pCtx)
+{
+    int         rval = 0;
+    uint32_t    retry_mask = 0;     // the outputs of a failed emitting
+
+    while( !rval )
+    {
+        int             i;
+        int             fd = -1;
+        int             ini_wd = -1;
+        int             bin_wd = -1;
+        int             is_ini_changed = 0;
+        const char      *pIni_name = 0;
+        const char      *pBin_name = 0;
+        int             *pMap_wd = 0;
+        const char      **ppMap_name = 0;
+        uint8_t         *pIs_changed = 0;
+
+        do {
+            char        str_buf[MAX_STR_LEN] = {0};
+
+            if( (fd = inotify_init()) < 0 )
+            {
+                rval = -1;
+                err_msg("inotify_init fail \n");
+                break;
+            }
+
+            if( !(pMap_wd = malloc(pCtx->map_file_cnt * sizeof(int) + 1)) ||
+                !(ppMap_name = malloc(pCtx->map_file_cnt * sizeof(char*) + 1)) ||
+                !(pIs_changed = malloc(pCtx->map_file_cnt + 1)) )
+            {
+                rval = -1;
+                err_msg("malloc %d fail \n", pCtx->map_file_cnt * sizeof(char*));
+                break;
+            }
+
+            if( (ini_wd = _watch__add(fd, pCtx->pIni_path, 0, &pIni_name)) < 0 )
+            {
+                rval = -1;
+                err_msg("watch '%s' fail \n", pCtx->pIni_path);
+                break;
+            }
+
+            for(i = 0; i < pCtx->map_file_cnt; i++)
+            {
+                const char  *pPath = 0;
+
+                snprintf(str_buf, MAX_STR_LEN, "in_file:keil_map_file_path_%d", i);
+                pPath = iniparser_getstring(pCtx->pIni, str_buf, NULL);
+                if( !pPath || !strcmp(pPath, STDIN_PATH) )
+                {
+                    rval = -1;
+                    err_msg("'%s' can not be watched \n", (pPath) ? pPath : str_buf);
+                    break;
+                }
+
+                if( (pMap_wd[i] = _watch__add(fd, pPath, 0, &ppMap_name[i])) < 0 )
+                {
+                    rval = -1;
+                    err_msg("watch '%s' fail \n", pPath);
+                    break;
+                }
+            }
+
+            if( rval )  break;
+
+            // the bin files are optional, INCBIN of the rom merge list takes them
+            if( pCtx->pBin_dir )
+                bin_wd = _watch__add(fd, pCtx->pBin_dir, 1, &pBin_name);
+
+            fprintf(stderr, "watching '%s' (%d map files) ...\n", pCtx->pIni_path, pCtx->map_file_cnt);
+
+            while( !is_ini_changed )
+            {
+                char            event_buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+                struct pollfd   poll_fd;
+                int             timeout = -1;
+                int             is_bin_changed = 0;
+                int             is_map_changed = 0;
+                uint32_t        out_mask = 0;
+
+                memset(pIs_changed, 0x0, pCtx->map_file_cnt);
+
+                poll_fd.fd     = fd;
+                poll_fd.events = POLLIN;
+
+                // wait the first event, then collect the others until the inputs settle down
+                while( poll(&poll_fd, 1, timeout) > 0 )
+                {
+                    char        *pCur = event_buf;
+                    ssize_t     len = read(fd, event_buf, sizeof(event_buf));
+
+                    if( len <= 0 )
+                        break;
+
+                    timeout = WATCH_SETTLE_MS;
+
+                    while( pCur < event_buf + len )
+                    {
+                        struct inotify_event    *pEvent = (struct inotify_event*)pCur;
+
+                        pCur += sizeof(struct inotify_event) + pEvent->len;
+
+                        // missed events, reload everything
+                        if( pEvent->mask & (IN_Q_OVERFLOW | IN_IGNORED) )
+                        {
+                            is_ini_changed = 1;
+                            continue;
+                        }
+
+                        if( !pEvent->len )
+                            continue;
+
+                        if( pEvent->wd == ini_wd && !strcmp(pEvent->name, pIni_name) )
+                            is_ini_changed = 1;
+
+                        for(i = 0; i < pCtx->map_file_cnt; i++)
+                        {
+                            if( pEvent->wd == pMap_wd[i] && !strcmp(pEvent->name, ppMap_name[i]) )
+                                pIs_changed[i] = 1;
+                        }
+
+                        if( pEvent->wd == bin_wd && strlen(pEvent->name) > 4 &&
+                            !strcmp(pEvent->name + strlen(pEvent->name) - 4, ".bin") )
+                            is_bin_changed = 1;
+                    }
+                }
+
+                if( is_ini_changed )
+                    break;
+
+                for(i = 0; i < pCtx->map_file_cnt; i++)
+                {
+                    snprintf(str_buf, MAX_STR_LEN, "in_file:keil_map_file_path_%d", i);
+
+                    // removed again (e.g. a failed link), wait the next one
+                    if( pIs_changed[i] && access(iniparser_getstring(pCtx->pIni, str_buf, ""), R_OK) )
+                        pIs_changed[i] = 0;
+
+                    is_map_changed |= pIs_changed[i];
+                }
+
+                // no records (a failed reload), parse all the map files again
+                if( (is_map_changed || is_bin_changed) && !pCtx->pFw_info )
+                {
+                    memset(pIs_changed, 0x1, pCtx->map_file_cnt);
+                    is_map_changed = 1;
+                    retry_mask     = OUT_FILE_MASK_ALL;
+                }
+
+                // a broken map file keeps its last records, the next change parses it again
+                if( is_map_changed && _parse_maps(pCtx, pIs_changed, &out_mask) )
+                    fprintf(stderr, "parse the map files fail, keep watching ...\n");
+
+                // the content is the same, touch it for the assembler to take the new bin files
+                if( is_bin_changed )
+                {
+                    out_mask |= (0x1 << OUT_FILE_ROM_MERGE_LIST) | (0x1 << OUT_FILE_FLASH_IMAGE);
+
+                    // the md5, the rom crc and the AES IV follow the bin files
+                    if( iniparser_getboolean(pCtx->pIni, "tag:enable_md5", 0) ||
+                        iniparser_getboolean(pCtx->pIni, "tag:enable_rom_crc32", 0) ||
+                        iniparser_getstring(pCtx->pIni, "aes:key_file", NULL) )
+                        out_mask |= (0x1 << OUT_FILE_FW_HEADER);
+                }
+
+                out_mask |= retry_mask;
+                if( !out_mask || !pCtx->pFw_info )
+                    continue;
+
+                // the outputs are regenerated by the next change
+                if( _emit_outputs(pCtx, out_mask, (is_bin_changed) ? (0x1 << OUT_FILE_ROM_MERGE_LIST) : 0) )
+                {
+                    retry_mask = out_mask;
+                    fprintf(stderr, "regenerate outputs (mask 0x%x) fail, keep watching ...\n", out_mask);
+                    continue;
+                }
+
+                retry_mask = 0;
+                fprintf(stderr, "regenerate outputs (mask 0x%x)\n", out_mask);
+            }
+        } while(0);
+
+        if( fd >= 0 )       close(fd);
+        if( pMap_wd )       free(pMap_wd);
+        if( ppMap_name )    free(ppMap_name);
+        if( pIs_changed )   free(pIs_changed);
+
+        if( rval )  break;
+
+        // a new ini: the map files, the outputs or the cache may be different
+        _release_config(pCtx);
+
+        if( (rval = _load_config(pCtx)) )
+            break;
+
+        if( !(pIs_changed = malloc(pCtx->map_file_cnt + 1)) )
+        {
+            rval = -1;
+            err_msg("malloc %d fail \n", pCtx->map_file_cnt);
+            break;
+        }
+        memset(pIs_changed, 0x1, pCtx->map_file_cnt);
+
+        retry_mask = OUT_FILE_MASK_ALL;
+        if( !_parse_maps(pCtx, pIs_changed, 0) && !_emit_outputs(pCtx, OUT_FILE_MASK_ALL, 0) )
+            retry_mask = 0;
+
+        free(pIs_changed);
+
+        fprintf(stderr, "reload '%s'%s\n", pCtx->pIni_path, (retry_mask) ? " fail, keep watching ..." : "");
+    }
+
+    return rval;
+}
+#endif
+//=============================================================================
+//                  Public Function Definition
+//=============================================================================
+void usage(char *progm)
+{
+    fprintf(stderr, "Copyright (c) 2018~ Wei-Lun Hsu. All rights reserved.\n"
+            "%s [options] [ini file]\n"
+            "    --regex-parser      match the region lines with the POSIX regex patterns\n"
+            "    --verify-parser     run the lexer and the regex patterns on every line of\n"
+            "                        the memory map section and fail on any difference\n"
+            "    --no-cache          ignore the parse cache of the ini ([cache] parse_cache_path)\n"
+            "    --watch             keep running, re-parse the changed map files and regenerate\n"
+            "                        the affected outputs (inotify, Linux only), a failed\n"
+            "                        run is reported and retried on the next change\n"
+            "    -j N                parse with N threads (0: one per cpu), the map files are\n"
+            "                        parsed at the same time and a large mapped map file is\n"
+            "                        split into chunks\n"
+            "    keil_map_file_path_N may be '-' (stdin), a FIFO or /dev/fd/N (process substitution)\n",
+            progm);
+    exit(-1);
+}
+
+int main(int arc, char **argv)
+{
+    int                 rval = 0;
+    int                 i;
+    uint8_t             *pIs_selected = 0;
+    gen_ctx_t           gen_ctx;
+
+    memset(&gen_ctx, 0x0, sizeof(gen_ctx));
+    gen_ctx.parser     = MAP_PARSER_LEXER;
+    gen_ctx.thread_num = 1;
+
+    do {
+        {
+            time_t      rawtime;
+            struct tm   *timeinfo;
+            time(&rawtime);
+
+            timeinfo = localtime(&rawtime);
+
+            if( timeinfo->tm_year + 1900 >= LIMIT_YEAR &&
+                timeinfo->tm_mon + 1 >= LIMIT_MONTH )
+                return 0;
+        }
+
+        for(i = 1; i < arc; i++)
+        {
+            if( !strcmp(argv[i], "--regex-parser") )
+                gen_ctx.parser = MAP_PARSER_REGEX;
+            else if( !strcmp(argv[i], "--verify-parser") )
+                gen_ctx.parser = MAP_PARSER_VERIFY;
+            else if( !strcmp(argv[i], "--no-cache") )
+                gen_ctx.is_cache_off = 1;
+            else if( !strcmp(argv[i], "--watch") )
+                gen_ctx.is_watch = 1;
+            else if( !strncmp(argv[i], "-j", 2) )
+            {
+                const char  *pNum = (argv[i][2]) ? &argv[i][2] : (i + 1 < arc) ? argv[++i] : "";
+
+                if( *pNum < '0' || *pNum > '9' )
+                    usage(argv[0]);
+
+                // -j 0: one thread per cpu
+                gen_ctx.thread_num = atoi(pNum);
+                gen_ctx.thread_num = (gen_ctx.thread_num > 0) ? gen_ctx.thread_num : task_pool__cpu_num();
+            }
+            else if( argv[i][0] == '-' || gen_ctx.pIni_path )
+                usage(argv[0]);
+            else
+                gen_ctx.pIni_path = argv[i];
+        }
+
+        if( !gen_ctx.pIni_path )
+            usage(argv[0]);
+
+        // a daemon does not hang on an error
+        if( gen_ctx.is_watch )
+            g_is_err_hang = 0;
+
+        if( (rval = _load_config(&gen_ctx)) )
+            break;
+
+        if( !(pIs_selected = malloc(gen_ctx.map_file_cnt + 1)) )
+        {
+            rval = -1;
+            err_msg("malloc %d fail \n", gen_ctx.map_file_cnt);
+            break;
+        }
+        memset(pIs_selected, 0x1, gen_ctx.map_file_cnt);
+
+        if( (rval = _parse_maps(&gen_ctx, pIs_selected, 0)) )
+            break;
+
+        #if 0 // debug message
+        {
+            int     j;
+
+            for(i = 0; i < gen_ctx.map_file_cnt; i++)
+            {
+                fw_info_t   *pCur_fw_info = &gen_ctx.pFw_info[i];
+
+                printf("\n\nrom cnt = %d\n", pCur_fw_info->rom_cnt);
+                for(j = 0; j < pCur_fw_info->rom_cnt; j++)
+                {
+                    printf("\tname: %s\n", pCur_fw_info->pRom_name[j]);
+                    printf("\tbase: x%08x\n", pCur_fw_info->pBase_addr[j]);
+                    printf("\tsize: x%08x\n", pCur_fw_info->pRom_size[j]);
+                    printf("\tmax : x%08x\n\n", pCur_fw_info->pRom_max_size[j]);
+                }
+            }
+        }
+        #endif
+
+        // generate output file
+        if( (rval = _emit_outputs(&gen_ctx, OUT_FILE_MASK_ALL, 0)) )
+            break;
+
+        if( gen_ctx.is_watch )
+        {
+        #if defined(__linux__)
+            rval = _watch_inputs(&gen_ctx);
+        #else
+            rval = -1;
+            err_msg("--watch is not supported on this platform\n");
+        #endif
+        }
+    } while(0);
+
+    if( pIs_selected )  free(pIs_selected);
+
+    _release_config(&gen_ctx);
+
+    return rval;
+}
@@ -0,0 +1,127 @@
+/**
+ * Copyright (c) 2018 Wei-Lun Hsu. All Rights Reserved.
+ */
+/** @file md5.h
+ *
+ * @author Wei-Lun Hsu
+ * @version 0.1
+ * @date 2026/10/17
+ * @license
+ * @description
+ *      streaming MD5 (RFC 1321) and HMAC-MD5 (RFC 2104)
+ */
+
+#ifndef __md5_H_wN6fD3Qs_lH9v_HKt5_sPz2_uEc7Rm4Yja8B__
+#define __md5_H_wN6fD3Qs_lH9v_HKt5_sPz2_uEc7Rm4Yja8B__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+//=============================================================================
+//                  Constant Definition
+//=============================================================================
+#define MD5_DIGEST_SIZE         16
+#define MD5_BLOCK_SIZE          64
+//=============================================================================
+//                  Macro Definition
+//=============================================================================
+
+//=============================================================================
+//                  Structure Definition
+//=============================================================================
+typedef struct md5_ctx
+{
+    uint32_t    state[4];
+    uint64_t    total_len;      // bytes
+    uint8_t     block[64];      // the tail which is not a whole block yet
+
+} md5_ctx_t;
+
+typedef struct md5_hmac_ctx
+{
+    md5_ctx_t   inner;                      // md5(key ^ ipad || data)
+    uint8_t     opad_key[MD5_BLOCK_SIZE];   // key ^ opad of the outer hash
+
+} md5_hmac_ctx_t;
+//=============================================================================
+//                  Global Data Definition
+//=============================================================================
+
+//=============================================================================
+//                  Private Function Definition
+//=============================================================================
+
+//=============================================================================
+//                  Public Function Definition
+//=============================================================================
+void
+md5__init(
+    md5_ctx_t   *pCtx);
+
+
+void
+md5__update(
+    md5_ctx_t       *pCtx,
+    const void      *pData,
+    size_t          len);
+
+
+/**
+ *  @brief  md5__final
+ *
+ *  @param [in] pCtx            the context (it should be initialized again for the next data)
+ *  @param [in] digest          the MD5 in the byte order of RFC 1321
+ *  @return
+ *      none
+ */
+void
+md5__final(
+    md5_ctx_t   *pCtx,
+    uint8_t     digest[MD5_DIGEST_SIZE]);
+
+
+/**
+ *  @brief  md5__hmac_init
+ *
+ *  @param [in] pCtx            the HMAC context
+ *  @param [in] pKey            the key, a key longer than MD5_BLOCK_SIZE is hashed first
+ *  @param [in] key_len         the bytes of pKey
+ *  @return
+ *      none
+ */
+void
+md5__hmac_init(
+    md5_hmac_ctx_t  *pCtx,
+    const void      *pKey,
+    size_t          key_len);
+
+
+void
+md5__hmac_update(
+    md5_hmac_ctx_t  *pCtx,
+    const void      *pData,
+    size_t          len);
+
+
+/**
+ *  @brief  md5__hmac_final
+ *
+ *  @param [in] pCtx            the HMAC context (the key pads are wiped)
+ *  @param [in] digest          the HMAC-MD5
+ *  @return
+ *      none
+ */
+void
+md5__hmac_final(
+    md5_hmac_ctx_t  *pCtx,
+    uint8_t         digest[MD5_DIGEST_SIZE]);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
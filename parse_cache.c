@@ -0,0 +1,657 @@
+/**
+ * Copyright (c) 2018 Wei-Lun Hsu. All Rights Reserved.
+ */
+/** @file parse_cache.c
+ *
+ * @author Wei-Lun Hsu
+ * @version 0.1
+ * @date 2026/10/17
+ * @license
+ * @description
+ */
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE     200809L
+#endif
+
+#if !defined(_WIN32) && !defined(_XOPEN_SOURCE)
+#define _XOPEN_SOURCE       700     // realpath()
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#include "crc32.h"
+#include "parse_cache.h"
+//=============================================================================
+//                  Constant Definition
+//=============================================================================
+#define PARSE_CACHE_PATH_MAX            4096
+#define PARSE_CACHE_IO_BLOCK_SIZE       (1 << 20)
+//=============================================================================
+//                  Macro Definition
+//=============================================================================
+#define dbg_msg(str, args...)           fprintf(stderr, "%s[%u] " str, __func__, __LINE__, ##args);
+//=============================================================================
+//                  Structure Definition
+//=============================================================================
+/**
+ *  the cache file:
+ *      parse_cache_file_hdr_t
+ *      { parse_cache_entry_hdr_t, path (no '\0'), parse_cache_rom_t[rom_cnt] } x entry_cnt
+ *
+ *  body_crc is calc_crc32() of the entries, the native endian of the host is used
+ */
+typedef struct parse_cache_file_hdr
+{
+    uint32_t    magic;
+    uint32_t    version;
+    uint32_t    entry_cnt;
+    uint32_t    body_crc;
+
+} parse_cache_file_hdr_t;
+
+typedef struct parse_cache_entry_hdr
+{
+    uint32_t    path_len;
+    uint32_t    rom_cnt;
+    uint32_t    crc;
+    uint32_t    reserved;
+    int64_t     file_size;
+    int64_t     mtime_sec;
+    int64_t     mtime_nsec;
+
+} parse_cache_entry_hdr_t;
+//=============================================================================
+//                  Global Data Definition
+//=============================================================================
+
+//=============================================================================
+//                  Private Function Definition
+//=============================================================================
+/**
+ *  the lock file is never replaced, so the lock covers every version of the cache file
+ *
+ *  @return
+ *      the fd of the locked file or -1 (no lock)
+ */
+static int
+_parse_cache__lock(
+    const char  *pCache_path,
+    int         is_write)
+{
+    int     fd = -1;
+
+#if !defined(_WIN32)
+    char            lock_path[PARSE_CACHE_PATH_MAX] = {0};
+    struct flock    lock;
+
+    snprintf(lock_path, sizeof(lock_path), "%s.lock", pCache_path);
+
+    if( (fd = open(lock_path, O_RDWR | O_CREAT, 0644)) < 0 )
+    {
+        dbg_msg("open '%s' fail, the cache is not locked\n", lock_path);
+        return -1;
+    }
+
+    memset(&lock, 0x0, sizeof(lock));
+    lock.l_type   = (is_write) ? F_WRLCK : F_RDLCK;
+    lock.l_whence = SEEK_SET;
+
+    while( fcntl(fd, F_SETLKW, &lock) )
+    {
+        if( errno == EINTR )
+            continue;
+
+        dbg_msg("lock '%s' fail, the cache is not locked\n", lock_path);
+        close(fd);
+        fd = -1;
+        break;
+    }
+#endif
+
+    return fd;
+}
+
+static void
+_parse_cache__unlock(int fd)
+{
+#if !defined(_WIN32)
+    if( fd >= 0 )
+        close(fd);  // the locks of the process are released
+#endif
+    return;
+}
+
+static int
+_parse_cache__stat(
+    const char          *pPath,
+    parse_cache_key_t   *pKey)
+{
+    struct stat     st;
+
+    memset(pKey, 0x0, sizeof(parse_cache_key_t));
+
+    if( stat(pPath, &st) || !S_ISREG(st.st_mode) )
+        return -1;
+
+    // the whole file is mapped
+    if( (uint64_t)st.st_size > SIZE_MAX )
+        return -1;
+
+    pKey->file_size = (int64_t)st.st_size;
+    pKey->mtime_sec = (int64_t)st.st_mtime;
+
+#if defined(__linux__)
+    pKey->mtime_nsec = (int64_t)st.st_mtim.tv_nsec;
+#elif defined(__APPLE__)
+    pKey->mtime_nsec = (int64_t)st.st_mtimespec.tv_nsec;
+#endif
+
+    return 0;
+}
+
+static int
+_parse_cache__file_crc(
+    const char          *pPath,
+    parse_cache_key_t   *pKey)
+{
+    int         rval = -1;
+    uint8_t     *pData = 0;
+    FILE        *fin = 0;
+    uint32_t    crc = crc32__init();
+
+    if( !pKey->file_size )
+    {
+        pKey->crc = crc32__final(crc);
+        return 0;
+    }
+
+    if( !(fin = fopen(pPath, "rb")) )
+        return -1;
+
+#if !defined(_WIN32)
+    pData = mmap(0, (size_t)pKey->file_size, PROT_READ, MAP_PRIVATE, fileno(fin), 0);
+    if( pData != MAP_FAILED )
+    {
+        posix_madvise(pData, (size_t)pKey->file_size, POSIX_MADV_SEQUENTIAL);
+
+        pKey->crc = crc32__final(crc32__update(crc, pData, (size_t)pKey->file_size));
+        munmap(pData, (size_t)pKey->file_size);
+        fclose(fin);
+        return 0;
+    }
+    pData = 0;
+#endif
+
+    do {
+        int64_t     remain = pKey->file_size;
+
+        if( !(pData = malloc(PARSE_CACHE_IO_BLOCK_SIZE)) )
+            break;
+
+        while( remain )
+        {
+            size_t      len = (remain < PARSE_CACHE_IO_BLOCK_SIZE) ? (size_t)remain : PARSE_CACHE_IO_BLOCK_SIZE;
+
+            if( fread(pData, 1, len, fin) != len )
+                break;
+
+            crc = crc32__update(crc, pData, len);
+            remain -= len;
+        }
+
+        if( remain )    break;
+
+        pKey->crc = crc32__final(crc);
+        rval = 0;
+    } while(0);
+
+    if( pData )     free(pData);
+    fclose(fin);
+
+    return rval;
+}
+
+/**
+ *  the entry name of a map file, the projects sharing a cache file give other relative paths
+ *  ('./x.map', '../a/x.map') of the same file and the same relative path of other files
+ */
+static const char*
+_parse_cache__entry_path(
+    const char  *pPath,
+    char        real_path[PATH_MAX])
+{
+#if defined(_WIN32)
+    if( _fullpath(real_path, pPath, PATH_MAX) )
+        return real_path;
+#else
+    if( realpath(pPath, real_path) )
+        return real_path;
+#endif
+
+    return pPath;
+}
+
+static parse_cache_entry_t*
+_parse_cache__find(
+    parse_cache_t   *pHCache,
+    const char      *pPath)
+{
+    uint32_t    i;
+
+    for(i = 0; i < pHCache->entry_cnt; i++)
+    {
+        if( !strcmp(pHCache->pEntries[i].pPath, pPath) )
+            return &pHCache->pEntries[i];
+    }
+
+    return 0;
+}
+
+static void
+_parse_cache__free_entry(
+    parse_cache_entry_t     *pEntry)
+{
+    if( pEntry->pPath )     free(pEntry->pPath);
+    if( pEntry->pRoms )     free(pEntry->pRoms);
+
+    memset(pEntry, 0x0, sizeof(parse_cache_entry_t));
+    return;
+}
+
+/**
+ *  add or replace an entry, the oldest one is dropped when the cache is full
+ */
+static int
+_parse_cache__put(
+    parse_cache_t       *pHCache,
+    const char          *pPath,
+    long                path_len,
+    parse_cache_key_t   *pKey,
+    parse_cache_rom_t   *pRoms,
+    uint32_t            rom_cnt,
+    int                 is_dirty)
+{
+    parse_cache_entry_t     entry;
+    parse_cache_entry_t     *pEntry = 0;
+
+    memset(&entry, 0x0, sizeof(entry));
+
+    if( !(entry.pPath = malloc(path_len + 1)) ||
+        !(entry.pRoms = malloc(rom_cnt * sizeof(parse_cache_rom_t) + 1)) )
+    {
+        _parse_cache__free_entry(&entry);
+        return -1;
+    }
+
+    memcpy(entry.pPath, pPath, path_len);
+    entry.pPath[path_len] = '\0';
+    memcpy(entry.pRoms, pRoms, rom_cnt * sizeof(parse_cache_rom_t));
+    entry.rom_cnt  = rom_cnt;
+    entry.key      = *pKey;
+    entry.is_dirty = is_dirty;
+
+    if( (pEntry = _parse_cache__find(pHCache, entry.pPath)) )
+    {
+        _parse_cache__free_entry(pEntry);
+        *pEntry = entry;
+        return 0;
+    }
+
+    if( pHCache->entry_cnt == PARSE_CACHE_MAX_ENTRIES )
+    {
+        _parse_cache__free_entry(&pHCache->pEntries[0]);
+        memmove(&pHCache->pEntries[0], &pHCache->pEntries[1],
+                (pHCache->entry_cnt - 1) * sizeof(parse_cache_entry_t));
+        pHCache->entry_cnt--;
+    }
+
+    if( pHCache->entry_cnt == pHCache->capacity )
+    {
+        uint32_t                capacity = (pHCache->capacity) ? (pHCache->capacity << 1) : 16;
+        parse_cache_entry_t     *pEntries = realloc(pHCache->pEntries, capacity * sizeof(parse_cache_entry_t));
+
+        if( !pEntries )
+        {
+            _parse_cache__free_entry(&entry);
+            return -1;
+        }
+
+        pHCache->pEntries = pEntries;
+        pHCache->capacity = capacity;
+    }
+
+    pHCache->pEntries[pHCache->entry_cnt++] = entry;
+    return 0;
+}
+
+/**
+ *  read the cache file into pHCache, the caller holds the lock
+ */
+static int
+_parse_cache__read_file(
+    parse_cache_t   *pHCache,
+    const char      *pCache_path)
+{
+    int                     rval = -1;
+    long                    file_size = 0;
+    uint8_t                 *pBuf = 0;
+    FILE                    *fin = 0;
+    parse_cache_file_hdr_t  hdr;
+
+    if( !(fin = fopen(pCache_path, "rb")) )
+        return 0;   // no cache yet
+
+    do {
+        uint8_t     *pCur = 0;
+        uint8_t     *pEnd = 0;
+        uint32_t    i;
+
+        if( fread(&hdr, 1, sizeof(hdr), fin) != sizeof(hdr) ||
+            hdr.magic != PARSE_CACHE_MAGIC || hdr.version != PARSE_CACHE_VERSION )
+            break;
+
+        if( fseek(fin, 0l, SEEK_END) || (file_size = ftell(fin)) < (long)sizeof(hdr) )
+            break;
+
+        file_size -= sizeof(hdr);
+        fseek(fin, (long)sizeof(hdr), SEEK_SET);
+
+        if( !(pBuf = malloc(file_size + 1)) ||
+            fread(pBuf, 1, file_size, fin) != (size_t)file_size )
+            break;
+
+        if( calc_crc32(pBuf, (unsigned int)file_size) != hdr.body_crc )
+            break;
+
+        pCur = pBuf;
+        pEnd = pBuf + file_size;
+        for(i = 0; i < hdr.entry_cnt; i++)
+        {
+            parse_cache_entry_hdr_t     entry_hdr;
+            parse_cache_key_t           key;
+
+            if( pEnd - pCur < (long)sizeof(entry_hdr) )
+                break;
+
+            memcpy(&entry_hdr, pCur, sizeof(entry_hdr));
+            pCur += sizeof(entry_hdr);
+
+            if( (uint64_t)(pEnd - pCur) < (uint64_t)entry_hdr.path_len + (uint64_t)entry_hdr.rom_cnt * sizeof(parse_cache_rom_t) )
+                break;
+
+            key.file_size  = entry_hdr.file_size;
+            key.mtime_sec  = entry_hdr.mtime_sec;
+            key.mtime_nsec = entry_hdr.mtime_nsec;
+            key.crc        = entry_hdr.crc;
+
+            if( _parse_cache__put(pHCache, (char*)pCur, entry_hdr.path_len, &key,
+                                  (parse_cache_rom_t*)(pCur + entry_hdr.path_len), entry_hdr.rom_cnt, 0) )
+                break;
+
+            pCur += entry_hdr.path_len + entry_hdr.rom_cnt * sizeof(parse_cache_rom_t);
+        }
+
+        if( i < hdr.entry_cnt )
+            break;
+
+        rval = 0;
+    } while(0);
+
+    if( rval )
+        dbg_msg("'%s' is not a valid cache, ignore it\n", pCache_path);
+
+    if( pBuf )      free(pBuf);
+    fclose(fin);
+
+    return rval;
+}
+
+static int
+_parse_cache__write_file(
+    parse_cache_t   *pHCache,
+    const char      *pCache_path)
+{
+    int                     rval = -1;
+    uint32_t                i;
+    size_t                  body_size = 0;
+    uint8_t                 *pBody = 0;
+    uint8_t                 *pCur = 0;
+    FILE                    *fout = 0;
+    char                    tmp_path[PARSE_CACHE_PATH_MAX] = {0};
+    parse_cache_file_hdr_t  hdr;
+
+    for(i = 0; i < pHCache->entry_cnt; i++)
+        body_size += sizeof(parse_cache_entry_hdr_t) + strlen(pHCache->pEntries[i].pPath) +
+                     pHCache->pEntries[i].rom_cnt * sizeof(parse_cache_rom_t);
+
+    if( !(pBody = malloc(body_size + 1)) )
+        return -1;
+
+    pCur = pBody;
+    for(i = 0; i < pHCache->entry_cnt; i++)
+    {
+        parse_cache_entry_t         *pEntry = &pHCache->pEntries[i];
+        parse_cache_entry_hdr_t     entry_hdr;
+
+        memset(&entry_hdr, 0x0, sizeof(entry_hdr));
+        entry_hdr.path_len   = (uint32_t)strlen(pEntry->pPath);
+        entry_hdr.rom_cnt    = pEntry->rom_cnt;
+        entry_hdr.crc        = pEntry->key.crc;
+        entry_hdr.file_size  = pEntry->key.file_size;
+        entry_hdr.mtime_sec  = pEntry->key.mtime_sec;
+        entry_hdr.mtime_nsec = pEntry->key.mtime_nsec;
+
+        memcpy(pCur, &entry_hdr, sizeof(entry_hdr));
+        pCur += sizeof(entry_hdr);
+        memcpy(pCur, pEntry->pPath, entry_hdr.path_len);
+        pCur += entry_hdr.path_len;
+        memcpy(pCur, pEntry->pRoms, pEntry->rom_cnt * sizeof(parse_cache_rom_t));
+        pCur += pEntry->rom_cnt * sizeof(parse_cache_rom_t);
+    }
+
+    hdr.magic     = PARSE_CACHE_MAGIC;
+    hdr.version   = PARSE_CACHE_VERSION;
+    hdr.entry_cnt = pHCache->entry_cnt;
+    hdr.body_crc  = calc_crc32(pBody, (unsigned int)body_size);
+
+#if defined(_WIN32)
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", pCache_path);
+#else
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%ld.tmp", pCache_path, (long)getpid());
+#endif
+
+    do {
+        if( !(fout = fopen(tmp_path, "wb")) )
+            break;
+
+        if( fwrite(&hdr, 1, sizeof(hdr), fout) != sizeof(hdr) ||
+            fwrite(pBody, 1, body_size, fout) != body_size )
+            break;
+
+        if( fclose(fout) )
+        {
+            fout = 0;
+            break;
+        }
+        fout = 0;
+
+    #if defined(_WIN32)
+        remove(pCache_path);
+    #endif
+        if( rename(tmp_path, pCache_path) )
+            break;
+
+        rval = 0;
+    } while(0);
+
+    if( fout )      fclose(fout);
+    if( rval )      remove(tmp_path);
+
+    free(pBody);
+    return rval;
+}
+//=============================================================================
+//                  Public Function Definition
+//=============================================================================
+int
+parse_cache__load(
+    parse_cache_t   *pHCache,
+    const char      *pCache_path)
+{
+    int     lock_fd = -1;
+
+    memset(pHCache, 0x0, sizeof(parse_cache_t));
+
+    if( !(pHCache->pCache_path = malloc(strlen(pCache_path) + 1)) )
+        return -1;
+
+    snprintf(pHCache->pCache_path, strlen(pCache_path) + 1, "%s", pCache_path);
+
+    lock_fd = _parse_cache__lock(pCache_path, 0);
+
+    if( _parse_cache__read_file(pHCache, pCache_path) )
+    {
+        // a broken cache is rebuilt
+        while( pHCache->entry_cnt )
+            _parse_cache__free_entry(&pHCache->pEntries[--pHCache->entry_cnt]);
+    }
+
+    _parse_cache__unlock(lock_fd);
+    return 0;
+}
+
+int
+parse_cache__lookup(
+    parse_cache_t           *pHCache,
+    const char              *pMap_path,
+    parse_cache_key_t       *pKey,
+    parse_cache_entry_t     **ppEntry)
+{
+    parse_cache_entry_t     *pEntry = 0;
+    char                    real_path[PATH_MAX] = {0};
+
+    *ppEntry = 0;
+
+    if( _parse_cache__stat(pMap_path, pKey) )
+        return -1;
+
+    pEntry = _parse_cache__find(pHCache, _parse_cache__entry_path(pMap_path, real_path));
+    if( pEntry &&
+        pEntry->key.file_size == pKey->file_size &&
+        pEntry->key.mtime_sec == pKey->mtime_sec &&
+        pEntry->key.mtime_nsec == pKey->mtime_nsec )
+    {
+        *pKey    = pEntry->key;
+        *ppEntry = pEntry;
+        return 0;
+    }
+
+    if( _parse_cache__file_crc(pMap_path, pKey) )
+        return -1;
+
+    // touched (e.g. checked out again) but the same content
+    if( pEntry &&
+        pEntry->key.file_size == pKey->file_size &&
+        pEntry->key.crc == pKey->crc )
+    {
+        pEntry->key      = *pKey;
+        pEntry->is_dirty = 1;
+        *ppEntry = pEntry;
+        return 0;
+    }
+
+    return 1;
+}
+
+int
+parse_cache__store(
+    parse_cache_t       *pHCache,
+    const char          *pMap_path,
+    parse_cache_key_t   *pKey,
+    parse_cache_rom_t   *pRoms,
+    uint32_t            rom_cnt)
+{
+    char        real_path[PATH_MAX] = {0};
+    const char  *pPath = _parse_cache__entry_path(pMap_path, real_path);
+
+    return _parse_cache__put(pHCache, pPath, (long)strlen(pPath), pKey, pRoms, rom_cnt, 1);
+}
+
+int
+parse_cache__save(
+    parse_cache_t   *pHCache)
+{
+    int             rval = 0;
+    int             lock_fd = -1;
+    uint32_t        i;
+    parse_cache_t   latest;
+
+    for(i = 0; i < pHCache->entry_cnt; i++)
+    {
+        if( pHCache->pEntries[i].is_dirty )
+            break;
+    }
+
+    if( i == pHCache->entry_cnt || !pHCache->pCache_path )
+        return 0;
+
+    memset(&latest, 0x0, sizeof(latest));
+
+    lock_fd = _parse_cache__lock(pHCache->pCache_path, 1);
+
+    // other builds may have updated the cache since parse_cache__load()
+    if( _parse_cache__read_file(&latest, pHCache->pCache_path) )
+    {
+        while( latest.entry_cnt )
+            _parse_cache__free_entry(&latest.pEntries[--latest.entry_cnt]);
+    }
+
+    for(i = 0; i < pHCache->entry_cnt && !rval; i++)
+    {
+        parse_cache_entry_t     *pEntry = &pHCache->pEntries[i];
+
+        if( !pEntry->is_dirty )
+            continue;
+
+        rval = _parse_cache__put(&latest, pEntry->pPath, (long)strlen(pEntry->pPath),
+                                 &pEntry->key, pEntry->pRoms, pEntry->rom_cnt, 0);
+    }
+
+    if( !rval )
+        rval = _parse_cache__write_file(&latest, pHCache->pCache_path);
+
+    _parse_cache__unlock(lock_fd);
+
+    if( rval )
+        dbg_msg("update '%s' fail\n", pHCache->pCache_path);
+
+    parse_cache__release(&latest);
+    return rval;
+}
+
+void
+parse_cache__release(
+    parse_cache_t   *pHCache)
+{
+    while( pHCache->entry_cnt )
+        _parse_cache__free_entry(&pHCache->pEntries[--pHCache->entry_cnt]);
+
+    if( pHCache->pEntries )     free(pHCache->pEntries);
+    if( pHCache->pCache_path )  free(pHCache->pCache_path);
+
+    memset(pHCache, 0x0, sizeof(parse_cache_t));
+    return;
+}
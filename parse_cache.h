@@ -0,0 +1,167 @@
+/**
+ * Copyright (c) 2018 Wei-Lun Hsu. All Rights Reserved.
+ */
+/** @file parse_cache.h
+ *
+ * @author Wei-Lun Hsu
+ * @version 0.1
+ * @date 2026/10/17
+ * @license
+ * @description
+ *      an on-disk cache of the parsed region records of map files.
+ *      An entry is keyed by the map file path, size, mtime and the calc_crc32() of the content;
+ *      the content is only hashed when the size/mtime differ or a new entry is made.
+ *      The cache file is shared by concurrent builds with the fcntl() locks of '<cache>.lock'
+ *      and it is replaced by rename(), a reader never sees a partial file.
+ */
+
+#ifndef __parse_cache_H_wK5pR2Xv_lT8d_HQc4_sMe9_uBn3Wf7Lgy6A__
+#define __parse_cache_H_wK5pR2Xv_lT8d_HQc4_sMe9_uBn3Wf7Lgy6A__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+//=============================================================================
+//                  Constant Definition
+//=============================================================================
+#define PARSE_CACHE_MAGIC               0x434C5347  // "GSLC"
+#define PARSE_CACHE_VERSION             2   // 2: the entries are the absolute paths
+
+#define PARSE_CACHE_MAX_ENTRIES         256
+//=============================================================================
+//                  Macro Definition
+//=============================================================================
+
+//=============================================================================
+//                  Structure Definition
+//=============================================================================
+typedef struct parse_cache_rom
+{
+    char        rom_name[64];
+    uint64_t    base_addr;
+    uint64_t    rom_size;
+    uint64_t    rom_max_size;
+
+} parse_cache_rom_t;
+
+typedef struct parse_cache_key
+{
+    int64_t     file_size;
+    int64_t     mtime_sec;
+    int64_t     mtime_nsec;
+    uint32_t    crc;
+
+} parse_cache_key_t;
+
+typedef struct parse_cache_entry
+{
+    char                *pPath;     // the absolute path of the map file
+    parse_cache_key_t   key;
+
+    uint32_t            rom_cnt;
+    parse_cache_rom_t   *pRoms;
+
+    int                 is_dirty;   // made in this run, written by parse_cache__save()
+
+} parse_cache_entry_t;
+
+typedef struct parse_cache
+{
+    char                    *pCache_path;
+
+    parse_cache_entry_t     *pEntries;
+    uint32_t                entry_cnt;
+    uint32_t                capacity;
+
+} parse_cache_t;
+//=============================================================================
+//                  Global Data Definition
+//=============================================================================
+
+//=============================================================================
+//                  Private Function Definition
+//=============================================================================
+
+//=============================================================================
+//                  Public Function Definition
+//=============================================================================
+/**
+ *  @brief  parse_cache__load
+ *              load the entries of the cache file (shared lock).
+ *              A missing, stale or broken cache file is taken as an empty cache.
+ *
+ *  @param [in] pHCache         the cache
+ *  @param [in] pCache_path     the cache file path
+ *  @return
+ *      0: ok, others: fail
+ */
+int
+parse_cache__load(
+    parse_cache_t   *pHCache,
+    const char      *pCache_path);
+
+
+/**
+ *  @brief  parse_cache__lookup
+ *
+ *  @param [in] pHCache         the cache
+ *  @param [in] pMap_path       the map file path
+ *  @param [in] pKey            the key of the map file, for parse_cache__store() when not found
+ *  @param [in] ppEntry         the cached records when found
+ *  @return
+ *      0: found, 1: not found (pKey is ready), -1: the file can not be cached (pipe, too large, ...)
+ */
+int
+parse_cache__lookup(
+    parse_cache_t           *pHCache,
+    const char              *pMap_path,
+    parse_cache_key_t       *pKey,
+    parse_cache_entry_t     **ppEntry);
+
+
+/**
+ *  @brief  parse_cache__store
+ *              add or replace the entry of a map file in memory
+ *
+ *  @param [in] pHCache         the cache
+ *  @param [in] pMap_path       the map file path
+ *  @param [in] pKey            the key from parse_cache__lookup() (taken before parsing)
+ *  @param [in] pRoms           the parsed records
+ *  @param [in] rom_cnt         the number of records
+ *  @return
+ *      0: ok, others: fail
+ */
+int
+parse_cache__store(
+    parse_cache_t       *pHCache,
+    const char          *pMap_path,
+    parse_cache_key_t   *pKey,
+    parse_cache_rom_t   *pRoms,
+    uint32_t            rom_cnt);
+
+
+/**
+ *  @brief  parse_cache__save
+ *              merge the new entries into the latest cache file (exclusive lock) and replace it
+ *
+ *  @param [in] pHCache         the cache
+ *  @return
+ *      0: ok, others: fail
+ */
+int
+parse_cache__save(
+    parse_cache_t   *pHCache);
+
+
+void
+parse_cache__release(
+    parse_cache_t   *pHCache);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -18,10 +18,55 @@ extern "C" {
 #endif
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+
+#if defined(ENABLE_GZIP)
+#include <zlib.h>
+#endif
+
+#if defined(ENABLE_ZSTD)
+#include <zstd.h>
+#endif
+
+#if !defined(_WIN32)
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 //=============================================================================
 //                  Constant Definition
 //=============================================================================
+typedef enum partial_read_mode
+{
+    PARTIAL_READ_MODE_BUFFER    = 0,    // fread() into pBuf, refill on demand
+    PARTIAL_READ_MODE_MMAP,             // pBuf maps the whole file, no refill
+    PARTIAL_READ_MODE_ASYNC,            // a helper thread fread() the next chunk into a back buffer
+
+} partial_read_mode_t;
+
+/**
+ *  the compression of the input, detected by the magic bytes.
+ *  Compressed inputs are decompressed in chunks into pBuf and act as a stream.
+ *  Build with ENABLE_GZIP (link zlib) and/or ENABLE_ZSTD (link libzstd) to support them.
+ */
+typedef enum partial_read_codec
+{
+    PARTIAL_READ_CODEC_NONE     = 0,
+    PARTIAL_READ_CODEC_GZIP,            // 1F 8B
+    PARTIAL_READ_CODEC_ZSTD,            // 28 B5 2F FD
+
+} partial_read_codec_t;
+
+#define PARTIAL_READ_CODEC_IN_SIZE      (256 << 10)
+
+/**
+ *  the size of the read-ahead hint for the mapping mode,
+ *  the kernel loads the next chunk while the current one is parsed
+ */
+#define PARTIAL_READ_PREFETCH_SIZE      (4 << 20)
 
 //=============================================================================
 //                  Macro Definition
@@ -30,11 +75,51 @@ extern "C" {
 //=============================================================================
 //                  Structure Definition
 //=============================================================================
+typedef struct partial_read_codec_ctx
+{
+    unsigned char       *pIn_buf;       // compressed data
+    int                 is_frame_open;  // a gzip member or zstd frame is not finished yet
+
+#if defined(ENABLE_GZIP)
+    z_stream            zs;
+#endif
+
+#if defined(ENABLE_ZSTD)
+    ZSTD_DStream        *pZstd;
+    ZSTD_inBuffer       zin;
+#endif
+
+} partial_read_codec_ctx_t;
+
+typedef struct partial_read_async
+{
+    pthread_t           thread;
+    pthread_mutex_t     mutex;
+    pthread_cond_t      cond;
+
+    unsigned char       *pBuf_pool[2];  // pBuf_pool[0] is the buffer of the owner
+
+    /**
+     *  the helper thread fills pBack[head_room ~ buf_size),
+     *  the unparsed tail of the front buffer is copied in front of it when swapping
+     */
+    unsigned char       *pBack;
+    long                head_room;
+    long                back_bytes;
+
+    int                 is_pending;     // a read request is queued or in progress
+    int                 is_eof;
+    int                 is_exit;
+
+} partial_read_async_t;
+
 typedef struct partial_read
 {
+    partial_read_mode_t     mode;
+
     FILE            *fp;
-    long            file_size;
-    long            file_remain;
+    long            file_size;      // -1 when is_stream
+    long            file_remain;    // -1 (unknown) when is_stream, 0 after end of file
 
     unsigned char   *pBuf;
     long            buf_size;
@@ -43,10 +128,27 @@ typedef struct partial_read
     unsigned char   *pCur;
     unsigned char   *pEnd;
 
+    unsigned char           *pPrefetch;     // PARTIAL_READ_MODE_MMAP: the next chunk to hint
+    partial_read_async_t    *pAsync;        // PARTIAL_READ_MODE_ASYNC
+
     int             alignment;
     unsigned long   is_big_endian;
     unsigned long   is_restart;
 
+    /**
+     *  pipe, FIFO, stdin, ... no file size and no seeking,
+     *  data is read until end of file and is_restart is not supported
+     */
+    unsigned long   is_stream;
+
+    partial_read_codec_t        codec;
+    partial_read_codec_ctx_t    *pCodec_ctx;
+    int                         is_src_error;   // broken compressed data
+
+    // the magic bytes consumed by the codec detection of a non-seekable input
+    unsigned char   peek[4];
+    int             peek_len;
+    int             peek_pos;
 
 } partial_read_t;
 //=============================================================================
@@ -56,10 +158,443 @@ typedef struct partial_read
 //=============================================================================
 //                  Private Function Definition
 //=============================================================================
+static inline size_t
+_partial_read__fread(
+    partial_read_t  *pHReader,
+    unsigned char   *pDst,
+    size_t          len)
+{
+    size_t      nbytes = 0;
+
+    while( pHReader->peek_pos < pHReader->peek_len && nbytes < len )
+        pDst[nbytes++] = pHReader->peek[pHReader->peek_pos++];
+
+    if( nbytes < len )
+        nbytes += fread(pDst + nbytes, 1, len - nbytes, pHReader->fp);
+
+    return nbytes;
+}
+
+/**
+ *  read (decompressed) data of the input,
+ *  a short count means end of file (or is_src_error)
+ */
+static inline size_t
+_partial_read__read_src(
+    partial_read_t  *pHReader,
+    unsigned char   *pDst,
+    size_t          len)
+{
+    size_t                      nbytes = 0;
+    partial_read_codec_ctx_t    *pCtx = pHReader->pCodec_ctx;
+
+    switch( pHReader->codec )
+    {
+        default:
+        case PARTIAL_READ_CODEC_NONE:
+            nbytes = _partial_read__fread(pHReader, pDst, len);
+            break;
+
+    #if defined(ENABLE_GZIP)
+        case PARTIAL_READ_CODEC_GZIP:
+            pCtx->zs.next_out  = pDst;
+            pCtx->zs.avail_out = (uInt)len;
+            while( pCtx->zs.avail_out )
+            {
+                int     ret = 0;
+
+                if( !pCtx->zs.avail_in )
+                {
+                    pCtx->zs.next_in  = pCtx->pIn_buf;
+                    pCtx->zs.avail_in = (uInt)_partial_read__fread(pHReader, pCtx->pIn_buf, PARTIAL_READ_CODEC_IN_SIZE);
+                    if( !pCtx->zs.avail_in )
+                    {
+                        // truncated data
+                        pHReader->is_src_error |= pCtx->is_frame_open;
+                        break;
+                    }
+                }
+
+                pCtx->is_frame_open = 1;
+
+                ret = inflate(&pCtx->zs, Z_NO_FLUSH);
+                if( ret == Z_STREAM_END )
+                {
+                    // concatenated gzip members
+                    inflateReset(&pCtx->zs);
+                    pCtx->is_frame_open = 0;
+                    continue;
+                }
+
+                if( ret != Z_OK && ret != Z_BUF_ERROR )
+                {
+                    pHReader->is_src_error = 1;
+                    break;
+                }
+            }
+
+            nbytes = len - pCtx->zs.avail_out;
+            break;
+    #endif
+
+    #if defined(ENABLE_ZSTD)
+        case PARTIAL_READ_CODEC_ZSTD:
+            {
+                ZSTD_outBuffer      zout = { pDst, len, 0 };
+
+                while( zout.pos < zout.size )
+                {
+                    size_t      ret = 0;
+
+                    if( pCtx->zin.pos == pCtx->zin.size )
+                    {
+                        pCtx->zin.src  = pCtx->pIn_buf;
+                        pCtx->zin.pos  = 0;
+                        pCtx->zin.size = _partial_read__fread(pHReader, pCtx->pIn_buf, PARTIAL_READ_CODEC_IN_SIZE);
+                        if( !pCtx->zin.size )
+                        {
+                            // truncated data
+                            pHReader->is_src_error |= pCtx->is_frame_open;
+                            break;
+                        }
+                    }
+
+                    ret = ZSTD_decompressStream(pCtx->pZstd, &zout, &pCtx->zin);
+                    if( ZSTD_isError(ret) )
+                    {
+                        pHReader->is_src_error = 1;
+                        break;
+                    }
+
+                    // 0: a frame is completely decoded and flushed
+                    pCtx->is_frame_open = (ret != 0);
+                }
+
+                nbytes = zout.pos;
+            }
+            break;
+    #endif
+    }
+
+    return nbytes;
+}
+
+static void*
+_partial_read__async_routine(void *pArgv)
+{
+    partial_read_t          *pHReader = (partial_read_t*)pArgv;
+    partial_read_async_t    *pAsync = pHReader->pAsync;
+
+    pthread_mutex_lock(&pAsync->mutex);
+    while( 1 )
+    {
+        size_t      nbytes = 0;
+        long        req_size = pHReader->buf_size - pAsync->head_room;
+
+        while( !pAsync->is_pending && !pAsync->is_exit )
+            pthread_cond_wait(&pAsync->cond, &pAsync->mutex);
+
+        if( pAsync->is_exit )
+            break;
+
+        // read without the lock, the owner only touches the front buffer
+        pthread_mutex_unlock(&pAsync->mutex);
+
+        nbytes = _partial_read__read_src(pHReader, pAsync->pBack + pAsync->head_room, req_size);
+
+        pthread_mutex_lock(&pAsync->mutex);
+
+        pAsync->back_bytes = (long)nbytes;
+        pAsync->is_eof     = (nbytes < (size_t)req_size);
+        pAsync->is_pending = 0;
+        pthread_cond_broadcast(&pAsync->cond);
+    }
+    pthread_mutex_unlock(&pAsync->mutex);
+
+    return 0;
+}
+
+static inline void
+_partial_read__async_kick(
+    partial_read_async_t    *pAsync)
+{
+    pthread_mutex_lock(&pAsync->mutex);
+    pAsync->is_pending = 1;
+    pthread_cond_broadcast(&pAsync->cond);
+    pthread_mutex_unlock(&pAsync->mutex);
+    return;
+}
+
+static inline void
+_partial_read__async_wait(
+    partial_read_async_t    *pAsync)
+{
+    pthread_mutex_lock(&pAsync->mutex);
+    while( pAsync->is_pending )
+        pthread_cond_wait(&pAsync->cond, &pAsync->mutex);
+    pthread_mutex_unlock(&pAsync->mutex);
+    return;
+}
 
 //=============================================================================
 //                  Public Function Definition
 //=============================================================================
+/**
+ *  @brief  partial_read__open_codec
+ *              detect the compression of the opened fp by the magic bytes and prepare the decompressor.
+ *              A compressed input becomes a stream (no size, no restart).
+ *
+ *  @param [in] pHReader        the reader with an opened fp
+ *  @return
+ *      0: ok, others: the compression is not supported by this build or fail
+ */
+static inline int
+partial_read__open_codec(
+    partial_read_t  *pHReader)
+{
+    static const unsigned char  gzip_magic[] = { 0x1F, 0x8B };
+    static const unsigned char  zstd_magic[] = { 0x28, 0xB5, 0x2F, 0xFD };
+    partial_read_codec_ctx_t    *pCtx = 0;
+
+    pHReader->codec    = PARTIAL_READ_CODEC_NONE;
+    pHReader->peek_pos = 0;
+    pHReader->peek_len = (int)fread(pHReader->peek, 1, sizeof(pHReader->peek), pHReader->fp);
+
+    if( pHReader->peek_len >= (int)sizeof(gzip_magic) &&
+        !memcmp(pHReader->peek, gzip_magic, sizeof(gzip_magic)) )
+        pHReader->codec = PARTIAL_READ_CODEC_GZIP;
+    else if( pHReader->peek_len >= (int)sizeof(zstd_magic) &&
+             !memcmp(pHReader->peek, zstd_magic, sizeof(zstd_magic)) )
+        pHReader->codec = PARTIAL_READ_CODEC_ZSTD;
+
+    // a seekable input is rewound, otherwise the peeked bytes are replayed by the reading
+    if( !fseek(pHReader->fp, 0l, SEEK_SET) )
+        pHReader->peek_len = 0;
+
+    if( pHReader->codec == PARTIAL_READ_CODEC_NONE )
+        return 0;
+
+    pHReader->is_stream   = 1;
+    pHReader->file_size   = -1;
+    pHReader->file_remain = -1;
+
+    if( !(pCtx = malloc(sizeof(partial_read_codec_ctx_t))) )
+        return -1;
+
+    memset(pCtx, 0x0, sizeof(partial_read_codec_ctx_t));
+    pHReader->pCodec_ctx = pCtx;
+
+    if( !(pCtx->pIn_buf = malloc(PARTIAL_READ_CODEC_IN_SIZE)) )
+        return -1;
+
+    switch( pHReader->codec )
+    {
+    #if defined(ENABLE_GZIP)
+        case PARTIAL_READ_CODEC_GZIP:
+            // 15 + 32: max window with the gzip/zlib header auto detection
+            if( inflateInit2(&pCtx->zs, 15 + 32) != Z_OK )
+                return -1;
+            return 0;
+    #endif
+
+    #if defined(ENABLE_ZSTD)
+        case PARTIAL_READ_CODEC_ZSTD:
+            if( !(pCtx->pZstd = ZSTD_createDStream()) ||
+                ZSTD_isError(ZSTD_initDStream(pCtx->pZstd)) )
+                return -1;
+            return 0;
+    #endif
+
+        default:
+            break;
+    }
+
+    // not supported by this build
+    return -1;
+}
+
+static inline void
+partial_read__close_codec(
+    partial_read_t  *pHReader)
+{
+    partial_read_codec_ctx_t    *pCtx = pHReader->pCodec_ctx;
+
+    if( pCtx )
+    {
+    #if defined(ENABLE_GZIP)
+        if( pHReader->codec == PARTIAL_READ_CODEC_GZIP )
+            inflateEnd(&pCtx->zs);
+    #endif
+
+    #if defined(ENABLE_ZSTD)
+        if( pHReader->codec == PARTIAL_READ_CODEC_ZSTD && pCtx->pZstd )
+            ZSTD_freeDStream(pCtx->pZstd);
+    #endif
+
+        if( pCtx->pIn_buf )     free(pCtx->pIn_buf);
+        free(pCtx);
+    }
+
+    pHReader->pCodec_ctx = 0;
+    pHReader->codec      = PARTIAL_READ_CODEC_NONE;
+    return;
+}
+
+/**
+ *  @brief  partial_read__map_file
+ *              map the whole opened file to pBuf (read only).
+ *              pCur ~ pEnd cover the file content and partial_read__full_buf() never refills.
+ *
+ *  @param [in] pHReader        the reader with an opened fp
+ *  @return
+ *      0: ok, others: not a mappable (regular and non-empty) file, the reader is untouched
+ */
+static inline int
+partial_read__map_file(
+    partial_read_t  *pHReader)
+{
+    int         rval = -1;
+
+#if !defined(_WIN32)
+    do {
+        struct stat     st = {0};
+        void            *pMap = 0;
+
+        if( !pHReader->fp ||
+            fstat(fileno(pHReader->fp), &st) ||
+            !S_ISREG(st.st_mode) || st.st_size <= 0 )
+            break;
+
+        pMap = mmap(0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fileno(pHReader->fp), 0);
+        if( pMap == MAP_FAILED )
+            break;
+
+        posix_madvise(pMap, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+
+        pHReader->mode          = PARTIAL_READ_MODE_MMAP;
+        pHReader->pBuf          = (unsigned char*)pMap;
+        pHReader->buf_size      = (long)st.st_size;
+        pHReader->file_size     = (long)st.st_size;
+        pHReader->file_remain   = 0;
+
+        pHReader->pCur          = pHReader->pBuf;
+        pHReader->pEnd          = pHReader->pBuf + pHReader->file_size;
+        pHReader->pPrefetch     = pHReader->pBuf;
+
+        pHReader->buf_remain_data = pHReader->file_size;
+
+        rval = 0;
+    } while(0);
+#endif
+
+    return rval;
+}
+
+static inline void
+partial_read__unmap_file(
+    partial_read_t  *pHReader)
+{
+#if !defined(_WIN32)
+    if( pHReader->mode == PARTIAL_READ_MODE_MMAP && pHReader->pBuf )
+        munmap(pHReader->pBuf, (size_t)pHReader->buf_size);
+#endif
+
+    pHReader->mode = PARTIAL_READ_MODE_BUFFER;
+    pHReader->pBuf = 0;
+    return;
+}
+
+/**
+ *  @brief  partial_read__start_async
+ *              switch a buffered reader (fp and pBuf are ready) to the double-buffered read-ahead mode.
+ *              A helper thread loads the next chunk while the caller parses the current one.
+ *
+ *  @param [in] pHReader        the reader in PARTIAL_READ_MODE_BUFFER
+ *  @return
+ *      0: ok, others: fail and the reader stays in the synchronous buffered mode
+ */
+static inline int
+partial_read__start_async(
+    partial_read_t  *pHReader)
+{
+    partial_read_async_t    *pAsync = 0;
+
+    if( pHReader->mode != PARTIAL_READ_MODE_BUFFER || !pHReader->fp || !pHReader->pBuf )
+        return -1;
+
+    if( !(pAsync = malloc(sizeof(partial_read_async_t))) )
+        return -1;
+
+    memset(pAsync, 0x0, sizeof(partial_read_async_t));
+
+    if( !(pAsync->pBuf_pool[1] = malloc(pHReader->buf_size)) )
+    {
+        free(pAsync);
+        return -1;
+    }
+
+    pAsync->pBuf_pool[0] = pHReader->pBuf;
+    pAsync->pBack        = pAsync->pBuf_pool[1];
+    pAsync->head_room    = pHReader->buf_size >> 2;
+    pAsync->is_pending   = 1;   // start loading the first chunk right away
+
+    pthread_mutex_init(&pAsync->mutex, 0);
+    pthread_cond_init(&pAsync->cond, 0);
+
+    pHReader->pAsync = pAsync;
+    pHReader->mode   = PARTIAL_READ_MODE_ASYNC;
+
+    if( pthread_create(&pAsync->thread, 0, _partial_read__async_routine, pHReader) )
+    {
+        pthread_cond_destroy(&pAsync->cond);
+        pthread_mutex_destroy(&pAsync->mutex);
+        free(pAsync->pBuf_pool[1]);
+        free(pAsync);
+
+        pHReader->pAsync = 0;
+        pHReader->mode   = PARTIAL_READ_MODE_BUFFER;
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ *  @brief  partial_read__stop_async
+ *              join the helper thread and release the back buffer.
+ *              pBuf is restored to the buffer given by the owner.
+ */
+static inline void
+partial_read__stop_async(
+    partial_read_t  *pHReader)
+{
+    partial_read_async_t    *pAsync = pHReader->pAsync;
+
+    if( pHReader->mode != PARTIAL_READ_MODE_ASYNC || !pAsync )
+        return;
+
+    pthread_mutex_lock(&pAsync->mutex);
+    pAsync->is_exit = 1;
+    pthread_cond_broadcast(&pAsync->cond);
+    pthread_mutex_unlock(&pAsync->mutex);
+
+    pthread_join(pAsync->thread, 0);
+
+    pthread_cond_destroy(&pAsync->cond);
+    pthread_mutex_destroy(&pAsync->mutex);
+
+    free(pAsync->pBuf_pool[1]);
+
+    pHReader->pBuf   = pAsync->pBuf_pool[0];
+    pHReader->pCur   = pHReader->pBuf;
+    pHReader->pEnd   = pHReader->pBuf;
+    pHReader->pAsync = 0;
+    pHReader->mode   = PARTIAL_READ_MODE_BUFFER;
+
+    free(pAsync);
+    return;
+}
+
 static inline int
 partial_read__full_buf(
     partial_read_t  *pHReader,
@@ -71,8 +606,115 @@ partial_read__full_buf(
         size_t      nbytes = 0;
         long        remain_data = 0;
 
+        if( pHReader->mode == PARTIAL_READ_MODE_MMAP )
+        {
+            // the whole file is already in pBuf
+            if( pHReader->is_restart )
+            {
+                pHReader->pCur      = pHReader->pBuf;
+                pHReader->pEnd      = pHReader->pBuf + pHReader->file_size;
+                pHReader->pPrefetch = pHReader->pBuf;
+
+                pHReader->is_restart = 0;
+            }
+
+        #if !defined(_WIN32)
+            // keep one chunk ahead of pCur in flight (pBuf and the chunk size are page aligned)
+            while( pHReader->pPrefetch < pHReader->pEnd &&
+                   pHReader->pPrefetch < pHReader->pCur + PARTIAL_READ_PREFETCH_SIZE )
+            {
+                long    len = pHReader->pEnd - pHReader->pPrefetch;
+
+                len = (len < PARTIAL_READ_PREFETCH_SIZE) ? len : PARTIAL_READ_PREFETCH_SIZE;
+                posix_madvise(pHReader->pPrefetch, (size_t)len, POSIX_MADV_WILLNEED);
+
+                pHReader->pPrefetch += len;
+            }
+        #endif
+
+            pHReader->buf_remain_data = pHReader->pEnd - pHReader->pCur;
+            break;
+        }
+
+        if( pHReader->mode == PARTIAL_READ_MODE_ASYNC )
+        {
+            partial_read_async_t    *pAsync = pHReader->pAsync;
+
+            if( pHReader->is_restart )
+            {
+                if( pHReader->is_stream )
+                {
+                    rval = -1;
+                    break;
+                }
+
+                _partial_read__async_wait(pAsync);
+
+                fseek(pHReader->fp, 0l, SEEK_SET);
+                pHReader->file_remain = pHReader->file_size;
+
+                pHReader->pCur = pHReader->pBuf;
+                pHReader->pEnd = pHReader->pBuf;
+
+                pAsync->is_eof = 0;
+                _partial_read__async_kick(pAsync);
+
+                pHReader->is_restart = 0;
+            }
+
+            remain_data = pHReader->pEnd - pHReader->pCur;
+            if( pHReader->file_remain &&
+                remain_data < pAsync->head_room )
+            {
+                unsigned char   *pFront = pHReader->pBuf;
+
+                _partial_read__async_wait(pAsync);
+
+                // swap buffers, the unparsed tail goes right before the new data
+                if( remain_data )
+                    memcpy(pAsync->pBack + pAsync->head_room - remain_data, pHReader->pCur, remain_data);
+
+                nbytes = pAsync->back_bytes;
+
+                pHReader->pBuf = pAsync->pBack;
+                pHReader->pCur = pAsync->pBack + pAsync->head_room - remain_data;
+                pHReader->pEnd = pAsync->pBack + pAsync->head_room + nbytes;
+
+                if( pAsync->is_eof )
+                    pHReader->file_remain = 0;
+                else if( !pHReader->is_stream )
+                    pHReader->file_remain -= nbytes;
+
+                pAsync->pBack = pFront;
+
+                // is_src_error belongs to the helper thread again after kicking
+                if( pHReader->is_src_error )
+                {
+                    rval = -1;
+                    break;
+                }
+
+                if( pHReader->file_remain )
+                    _partial_read__async_kick(pAsync);
+
+                // after reading process
+                if( cb_post_read &&
+                    (rval = cb_post_read(pHReader->pEnd - nbytes, nbytes)) )
+                   break;
+            }
+
+            pHReader->buf_remain_data = pHReader->pEnd - pHReader->pCur;
+            break;
+        }
+
         if( pHReader->is_restart )
         {
+            if( pHReader->is_stream )
+            {
+                rval = -1;
+                break;
+            }
+
             fseek(pHReader->fp, 0l, SEEK_SET);
             pHReader->file_remain = pHReader->file_size;
 
@@ -90,12 +732,21 @@ partial_read__full_buf(
                 memmove(pHReader->pBuf, pHReader->pCur, remain_data);
 
             // full buffer
-            nbytes = fread(pHReader->pBuf + remain_data, 1, pHReader->buf_size - remain_data, pHReader->fp);
+            nbytes = _partial_read__read_src(pHReader, pHReader->pBuf + remain_data, pHReader->buf_size - remain_data);
 
             pHReader->pCur = pHReader->pBuf;
             pHReader->pEnd = pHReader->pBuf + remain_data + nbytes;
 
-            pHReader->file_remain -= nbytes;
+            if( nbytes < (size_t)(pHReader->buf_size - remain_data) )
+                pHReader->file_remain = 0;
+            else if( !pHReader->is_stream )
+                pHReader->file_remain -= nbytes;
+
+            if( pHReader->is_src_error )
+            {
+                rval = -1;
+                break;
+            }
 
             // after reading process
             if( cb_post_read &&
@@ -0,0 +1,150 @@
+/**
+ * Copyright (c) 2018 Wei-Lun Hsu. All Rights Reserved.
+ */
+/** @file task_pool.c
+ *
+ * @author Wei-Lun Hsu
+ * @version 0.1
+ * @date 2026/10/17
+ * @license
+ * @description
+ */
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE     200809L
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "task_pool.h"
+//=============================================================================
+//                  Constant Definition
+//=============================================================================
+
+//=============================================================================
+//                  Macro Definition
+//=============================================================================
+
+//=============================================================================
+//                  Structure Definition
+//=============================================================================
+typedef struct task_pool
+{
+    pthread_mutex_t     mutex;
+
+    int                 task_cnt;
+    int                 next_task;
+    cb_task_t           cb_task;
+    void                *pTask_info;
+
+    int                 fail_idx;   // the first failed task
+    int                 fail_rval;
+
+} task_pool_t;
+//=============================================================================
+//                  Global Data Definition
+//=============================================================================
+
+//=============================================================================
+//                  Private Function Definition
+//=============================================================================
+static void*
+_task_routine(void *pArgv)
+{
+    task_pool_t     *pPool = (task_pool_t*)pArgv;
+
+    while( 1 )
+    {
+        int     task_idx = 0;
+        int     rval = 0;
+
+        pthread_mutex_lock(&pPool->mutex);
+        task_idx = pPool->next_task++;
+        pthread_mutex_unlock(&pPool->mutex);
+
+        if( task_idx >= pPool->task_cnt )
+            break;
+
+        if( !(rval = pPool->cb_task(pPool->pTask_info, task_idx)) )
+            continue;
+
+        pthread_mutex_lock(&pPool->mutex);
+        if( task_idx < pPool->fail_idx )
+        {
+            pPool->fail_idx  = task_idx;
+            pPool->fail_rval = rval;
+        }
+        pthread_mutex_unlock(&pPool->mutex);
+    }
+
+    return 0;
+}
+//=============================================================================
+//                  Public Function Definition
+//=============================================================================
+int
+task_pool__run(
+    int         thread_num,
+    int         task_cnt,
+    cb_task_t   cb_task,
+    void        *pTask_info)
+{
+    int             i;
+    int             thread_cnt = 0;
+    pthread_t       threads[TASK_POOL_MAX_THREADS];
+    task_pool_t     pool;
+
+    memset(&pool, 0x0, sizeof(pool));
+    pool.task_cnt   = task_cnt;
+    pool.cb_task    = cb_task;
+    pool.pTask_info = pTask_info;
+    pool.fail_idx   = task_cnt;
+
+    thread_num = (thread_num < task_cnt) ? thread_num : task_cnt;
+    thread_num = (thread_num < TASK_POOL_MAX_THREADS) ? thread_num : TASK_POOL_MAX_THREADS;
+
+    pthread_mutex_init(&pool.mutex, 0);
+
+    // the caller is one of the workers
+    for(i = 1; i < thread_num; i++)
+    {
+        if( pthread_create(&threads[thread_cnt], 0, _task_routine, &pool) )
+            break;
+
+        thread_cnt++;
+    }
+
+    _task_routine(&pool);
+
+    for(i = 0; i < thread_cnt; i++)
+        pthread_join(threads[i], 0);
+
+    pthread_mutex_destroy(&pool.mutex);
+
+    return pool.fail_rval;
+}
+
+int
+task_pool__cpu_num(void)
+{
+    long    cpu_num = 1;
+
+#if defined(_WIN32)
+    SYSTEM_INFO     sys_info;
+
+    GetSystemInfo(&sys_info);
+    cpu_num = (long)sys_info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+    cpu_num = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+    return (cpu_num > 0) ? (int)cpu_num : 1;
+}
@@ -0,0 +1,81 @@
+/**
+ * Copyright (c) 2018 Wei-Lun Hsu. All Rights Reserved.
+ */
+/** @file task_pool.h
+ *
+ * @author Wei-Lun Hsu
+ * @version 0.1
+ * @date 2026/10/17
+ * @license
+ * @description
+ *      run independent tasks on a few threads, the caller thread also takes tasks
+ */
+
+#ifndef __task_pool_H_wM8sQ2Vd_lK4n_HXe7_sTc3_uFy9Bp5Rgj6H__
+#define __task_pool_H_wM8sQ2Vd_lK4n_HXe7_sTc3_uFy9Bp5Rgj6H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//=============================================================================
+//                  Constant Definition
+//=============================================================================
+#define TASK_POOL_MAX_THREADS       64
+//=============================================================================
+//                  Macro Definition
+//=============================================================================
+
+//=============================================================================
+//                  Structure Definition
+//=============================================================================
+/**
+ *  @brief  cb_task_t
+ *
+ *  @param [in] pTask_info      the user data of task_pool__run()
+ *  @param [in] task_idx        0 ~ (task_cnt - 1)
+ *  @return
+ *      0: ok, others: fail
+ */
+typedef int (*cb_task_t)(void *pTask_info, int task_idx);
+//=============================================================================
+//                  Global Data Definition
+//=============================================================================
+
+//=============================================================================
+//                  Private Function Definition
+//=============================================================================
+
+//=============================================================================
+//                  Public Function Definition
+//=============================================================================
+/**
+ *  @brief  task_pool__run
+ *              run task 0 ~ (task_cnt - 1) with thread_num threads and wait all of them.
+ *              The tasks are taken in index order, thread_num <= 1 runs them one by one.
+ *
+ *  @param [in] thread_num      the number of threads (the caller included)
+ *  @param [in] task_cnt        the number of tasks
+ *  @param [in] cb_task         the task routine
+ *  @param [in] pTask_info      the user data passed to cb_task
+ *  @return
+ *      0: all tasks ok, others: the return value of the first failed task (in index order)
+ */
+int
+task_pool__run(
+    int         thread_num,
+    int         task_cnt,
+    cb_task_t   cb_task,
+    void        *pTask_info);
+
+
+int
+task_pool__cpu_num(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
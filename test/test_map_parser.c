@@ -0,0 +1,174 @@
+/**
+ * Copyright (c) 2018 Wei-Lun Hsu. All Rights Reserved.
+ */
+/** @file test_map_parser.c
+ *
+ * @author Wei-Lun Hsu
+ * @version 0.1
+ * @date 2026/10/17
+ * @license
+ * @description
+ *      the differential test of the map parsers, the LF and the CRLF fixtures are parsed
+ *      by the lexer (default) and by the regex patterns (--regex-parser),
+ *      all the records MUST be the same as the expected ones
+ *
+ *      test_map_parser [fixture directory]
+ */
+
+// the parsers are static, the test takes main.c as a part of itself
+#define main        gen_scatter_loading_main
+#include "../main.c"
+#undef main
+//=============================================================================
+//                  Constant Definition
+//=============================================================================
+#define FIXTURE_DIR_DEFAULT         "test/fixtures/"
+//=============================================================================
+//                  Macro Definition
+//=============================================================================
+
+//=============================================================================
+//                  Structure Definition
+//=============================================================================
+typedef struct expect_rom
+{
+    const char      *pName;
+    unsigned long   base_addr;
+    unsigned long   rom_size;
+    unsigned long   rom_max_size;
+
+} expect_rom_t;
+//=============================================================================
+//                  Global Data Definition
+//=============================================================================
+static const char   *g_fixture_name[] =
+{
+    "sta_mode_lf.map",
+    "sta_mode_crlf.map",
+};
+
+static const struct
+{
+    map_parser_t    parser;
+    const char      *pName;
+
+} g_parser_list[] =
+{
+    { MAP_PARSER_LEXER,     "lexer", },
+    { MAP_PARSER_REGEX,     "regex", },
+    { MAP_PARSER_VERIFY,    "verify", },
+};
+
+// the execution regions of the fixtures, the first one of each load region in the memory map section
+static const expect_rom_t   g_expect_roms[] =
+{
+    { "ER_IROM1",       0x60000000, 0x00004a10, 0x00080000, },
+    { "ER_ROM_WIFI",    0x20010000, 0x00011ff4, 0x00020000, },
+    { "ER_ROM_BT",      0x20030000, 0x00000bc4, 0x0000c000, },
+};
+//=============================================================================
+//                  Private Function Definition
+//=============================================================================
+static int
+_test__parse(
+    const char      *pPath,
+    map_parser_t    parser,
+    arena_t         *pArena,
+    fw_info_t       *pFw_info)
+{
+    int             rval = 0;
+    partial_read_t  hReader;
+
+    memset(&hReader, 0x0, sizeof(hReader));
+    memset(pFw_info, 0x0, sizeof(fw_info_t));
+    pFw_info->pArena = pArena;
+
+    if( (rval = _create_reader(&hReader, pPath)) )
+        return rval;
+
+    rval = _parse_map_file(&hReader, pFw_info, parser, 1);
+
+    _destroy_reader(&hReader);
+    return rval;
+}
+
+static int
+_test__compare(
+    const char      *pCase,
+    fw_info_t       *pFw_info)
+{
+    int         rval = 0;
+    uint32_t    i;
+    uint32_t    expect_cnt = sizeof(g_expect_roms) / sizeof(g_expect_roms[0]);
+
+    if( pFw_info->rom_cnt != expect_cnt )
+    {
+        fprintf(stderr, "%s: %u roms, expect %u\n", pCase, pFw_info->rom_cnt, expect_cnt);
+        return -1;
+    }
+
+    for(i = 0; i < expect_cnt; i++)
+    {
+        const expect_rom_t  *pExpect = &g_expect_roms[i];
+
+        if( strcmp(pFw_info->pRom_name[i], pExpect->pName) ||
+            pFw_info->pBase_addr[i] != pExpect->base_addr ||
+            pFw_info->pRom_size[i] != pExpect->rom_size ||
+            pFw_info->pRom_max_size[i] != pExpect->rom_max_size )
+        {
+            fprintf(stderr, "%s: rom %u is '%s' (0x%lx, 0x%lx, 0x%lx), expect '%s' (0x%lx, 0x%lx, 0x%lx)\n",
+                    pCase, i, pFw_info->pRom_name[i],
+                    pFw_info->pBase_addr[i], pFw_info->pRom_size[i], pFw_info->pRom_max_size[i],
+                    pExpect->pName, pExpect->base_addr, pExpect->rom_size, pExpect->rom_max_size);
+            rval = -1;
+        }
+    }
+
+    return rval;
+}
+//=============================================================================
+//                  Public Function Definition
+//=============================================================================
+int main(int argc, char **argv)
+{
+    int         fail_cnt = 0;
+    int         i, j;
+    const char  *pDir = (argc > 1) ? argv[1] : FIXTURE_DIR_DEFAULT;
+
+    // a parser error fails the case, not hangs
+    g_is_err_hang = 0;
+
+    for(i = 0; i < (int)(sizeof(g_fixture_name) / sizeof(g_fixture_name[0])); i++)
+    {
+        for(j = 0; j < (int)(sizeof(g_parser_list) / sizeof(g_parser_list[0])); j++)
+        {
+            char        path[1024] = {0};
+            char        case_name[256] = {0};
+            arena_t     *pArena = 0;
+            fw_info_t   fw_info;
+            int         rval = 0;
+
+            snprintf(path, sizeof(path), "%s/%s", pDir, g_fixture_name[i]);
+            snprintf(case_name, sizeof(case_name), "%s (%s)", g_fixture_name[i], g_parser_list[j].pName);
+
+            if( !(pArena = arena__create(0)) )
+            {
+                fprintf(stderr, "%s: create arena fail\n", case_name);
+                return -1;
+            }
+
+            rval = _test__parse(path, g_parser_list[j].parser, pArena, &fw_info);
+            if( rval )
+                fprintf(stderr, "%s: parse fail\n", case_name);
+            else
+                rval = _test__compare(case_name, &fw_info);
+
+            arena__destroy(pArena);
+
+            fprintf(stderr, "%-8s %s\n", (rval) ? "[FAIL]" : "[ OK ]", case_name);
+            fail_cnt += !!rval;
+        }
+    }
+
+    return (fail_cnt) ? -1 : 0;
+}
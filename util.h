@@ -8,6 +8,7 @@
  * @date 2018/02/03
  * @license
  * @description
+ *      a growable string builder, the length is tracked and the text is always '\0' terminated
  */
 
 #ifndef __util_H_w9qZ7Kx8_lP6r_HWr9_sNur_uNhO5dWpEwc5__
@@ -17,29 +18,32 @@
 extern "C" {
 #endif
 
-
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
 //=============================================================================
 //                  Constant Definition
 //=============================================================================
-
+#define STR_BUILDER_INDENT          "    "
+#define STR_BUILDER_INDENT_LEN      4
 //=============================================================================
 //                  Macro Definition
 //=============================================================================
-#define PUSH_STRING(pStr_buf, layer, str_format, ...)                            \
-    do{ int  k;                                                                  \
-        for(k=0;k<layer;k++) sprintf(&pStr_buf[strlen(pStr_buf)], "    ");       \
-        sprintf(&pStr_buf[strlen(pStr_buf)], str_format, __VA_ARGS__);           \
-    }while(0)
-
-#define FLUSH_STRING(pFileIO, pStr_buf)             \
-    do{ fprintf(pFileIO, "%s", pStr_buf);           \
-        *(pStr_buf) = '\0';                         \
-    }while(0)
 
 //=============================================================================
 //                  Structure Definition
 //=============================================================================
+typedef struct str_builder
+{
+    char        *pBuf;
+    size_t      len;
+    size_t      capacity;
 
+    int         is_fail;    // a failed growing, the later appends are dropped
+
+} str_builder_t;
 //=============================================================================
 //                  Global Data Definition
 //=============================================================================
@@ -51,6 +55,189 @@ extern "C" {
 //=============================================================================
 //                  Public Function Definition
 //=============================================================================
+/**
+ *  @brief  str_builder__init
+ *
+ *  @param [in] pHStr           the builder
+ *  @param [in] capacity        the initial capacity (the text length)
+ *  @return
+ *      0: ok, others: fail
+ */
+static inline int
+str_builder__init(
+    str_builder_t   *pHStr,
+    size_t          capacity)
+{
+    memset(pHStr, 0x0, sizeof(str_builder_t));
+
+    capacity = (capacity) ? capacity : 256;
+    if( !(pHStr->pBuf = malloc(capacity + 1)) )
+    {
+        pHStr->is_fail = 1;
+        return -1;
+    }
+
+    pHStr->pBuf[0]  = '\0';
+    pHStr->capacity = capacity;
+    return 0;
+}
+
+/**
+ *  @brief  str_builder__reserve
+ *              make room for add_len more characters
+ *
+ *  @param [in] pHStr           the builder
+ *  @param [in] add_len         the characters to append
+ *  @return
+ *      0: ok, others: fail
+ */
+static inline int
+str_builder__reserve(
+    str_builder_t   *pHStr,
+    size_t          add_len)
+{
+    size_t      capacity = pHStr->capacity;
+    char        *pBuf = 0;
+
+    if( pHStr->is_fail )
+        return -1;
+
+    if( pHStr->len + add_len <= capacity )
+        return 0;
+
+    while( capacity < pHStr->len + add_len )
+        capacity = (capacity) ? capacity << 1 : 256;
+
+    if( !(pBuf = realloc(pHStr->pBuf, capacity + 1)) )
+    {
+        pHStr->is_fail = 1;
+        return -1;
+    }
+
+    pHStr->pBuf     = pBuf;
+    pHStr->capacity = capacity;
+    return 0;
+}
+
+static inline void
+str_builder__append(
+    str_builder_t   *pHStr,
+    const char      *pStr,
+    size_t          len)
+{
+    if( str_builder__reserve(pHStr, len) )
+        return;
+
+    memcpy(&pHStr->pBuf[pHStr->len], pStr, len);
+    pHStr->len += len;
+    pHStr->pBuf[pHStr->len] = '\0';
+    return;
+}
+
+static inline void
+str_builder__indent(
+    str_builder_t   *pHStr,
+    int             layer)
+{
+    while( layer-- > 0 )
+        str_builder__append(pHStr, STR_BUILDER_INDENT, STR_BUILDER_INDENT_LEN);
+
+    return;
+}
+
+/**
+ *  @brief  str_builder__printf
+ *
+ *  @param [in] pHStr           the builder
+ *  @param [in] layer           the indent levels in front of the text
+ *  @param [in] pFormat         printf() format
+ *  @return
+ *      none, pHStr->is_fail is set when it fails
+ */
+static inline void
+str_builder__printf(
+    str_builder_t   *pHStr,
+    int             layer,
+    const char      *pFormat,
+    ...)
+{
+    int         len = 0;
+    va_list     va;
+
+    str_builder__indent(pHStr, layer);
+    if( pHStr->is_fail )
+        return;
+
+    va_start(va, pFormat);
+    len = vsnprintf(&pHStr->pBuf[pHStr->len], pHStr->capacity - pHStr->len + 1, pFormat, va);
+    va_end(va);
+
+    if( len < 0 )
+    {
+        pHStr->is_fail = 1;
+        pHStr->pBuf[pHStr->len] = '\0';
+        return;
+    }
+
+    if( (size_t)len > pHStr->capacity - pHStr->len )
+    {
+        // truncated, grow and print again
+        if( str_builder__reserve(pHStr, (size_t)len) )
+        {
+            pHStr->pBuf[pHStr->len] = '\0';
+            return;
+        }
+
+        va_start(va, pFormat);
+        vsnprintf(&pHStr->pBuf[pHStr->len], pHStr->capacity - pHStr->len + 1, pFormat, va);
+        va_end(va);
+    }
+
+    pHStr->len += (size_t)len;
+    return;
+}
+
+/**
+ *  @brief  str_builder__hex
+ *              append the lower case hex digits of value, as "%0*llx" without the printf() parsing
+ *
+ *  @param [in] pHStr           the builder
+ *  @param [in] value           the value
+ *  @param [in] min_digits      the zero padded width (16 at most)
+ *  @return
+ *      none
+ */
+static inline void
+str_builder__hex(
+    str_builder_t   *pHStr,
+    uint64_t        value,
+    int             min_digits)
+{
+    static const char   hex_digits[] = "0123456789abcdef";
+    char                digits[16];
+    int                 cnt = 0;
+
+    do {
+        digits[15 - cnt++] = hex_digits[value & 0xF];
+        value >>= 4;
+    } while( value && cnt < 16 );
+
+    while( cnt < min_digits && cnt < 16 )
+        digits[15 - cnt++] = '0';
+
+    str_builder__append(pHStr, &digits[16 - cnt], cnt);
+    return;
+}
+
+static inline void
+str_builder__release(
+    str_builder_t   *pHStr)
+{
+    if( pHStr->pBuf )   free(pHStr->pBuf);
+
+    memset(pHStr, 0x0, sizeof(str_builder_t));
+    return;
+}
 
 #ifdef __cplusplus
 }